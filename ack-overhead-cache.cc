@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ack-overhead-cache.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("AckOverheadCache");
+
+AckOverheadCache::AckOverheadCache (std::size_t nEntries, std::size_t maxKeySize)
+  : m_nHits (0),
+    m_nMisses (0)
+{
+  std::size_t size = 1;
+  while (size < nEntries)
+    {
+      size <<= 1;
+    }
+  m_entries.resize (size, {{}, false, 0, false, Seconds (0)});
+  for (auto& entry : m_entries)
+    {
+      entry.key.reserve (maxKeySize);
+    }
+}
+
+AckOverheadCache::Entry&
+AckOverheadCache::Lookup (const std::vector<uint32_t>& key)
+{
+  NS_ASSERT (!key.empty ());
+
+  // FNV-1a hashing of the signature
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (uint32_t word : key)
+    {
+      hash = (hash ^ word) * 0x100000001b3ull;
+    }
+  Entry& entry = m_entries[(hash >> 32) & (m_entries.size () - 1)];
+
+  if (entry.key == key)
+    {
+      m_nHits++;
+      return entry;
+    }
+
+  m_nMisses++;
+  NS_LOG_DEBUG ("Signature of " << key.size () << " words not found in the cache");
+  // the assignment reuses the storage of the entry if large enough
+  entry.key.assign (key.begin (), key.end ());
+  entry.ulLengthValid = false;
+  entry.responseValid = false;
+  return entry;
+}
+
+void
+AckOverheadCache::Clear (void)
+{
+  for (auto& entry : m_entries)
+    {
+      entry.key.clear ();
+    }
+}
+
+uint64_t
+AckOverheadCache::GetNHits (void) const
+{
+  return m_nHits;
+}
+
+uint64_t
+AckOverheadCache::GetNMisses (void) const
+{
+  return m_nMisses;
+}
+
+} //namespace ns3
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ACK_OVERHEAD_CACHE_H
+#define ACK_OVERHEAD_CACHE_H
+
+#include "ns3/nstime.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * AckOverheadCache is a bounded, direct-mapped cache of the overhead of the
+ * acknowledgment sequence of DL MU PPDUs. Entries are keyed on a signature,
+ * i.e., a sequence of words built by the caller that encodes all the inputs
+ * of the computation (ack sequence type, PHY parameters and, for each user,
+ * RU type, MCS, NSS, BAR and BA type). Each entry stores the length of the
+ * HE TB PPDUs carrying the Block Acks and the duration of the response, which
+ * are filled in separately as they are computed. When two signatures map to
+ * the same entry, the most recent one replaces the other.
+ */
+class AckOverheadCache
+{
+public:
+  /// A cache entry
+  struct Entry
+  {
+    std::vector<uint32_t> key;  //!< the signature of the entry (empty if the entry is empty)
+    bool ulLengthValid;         //!< whether the UL length has been computed
+    uint16_t ulLength;          //!< the UL length of the HE TB PPDUs carrying Block Acks
+    bool responseValid;         //!< whether the response duration has been computed
+    Time response;              //!< the duration of the response to the DL MU PPDU
+  };
+
+  /**
+   * Create a cache with the given number of entries.
+   *
+   * \param nEntries the number of entries (rounded up to a power of two)
+   * \param maxKeySize the maximum size of a signature, which is reserved in
+   *                   advance for every entry
+   */
+  AckOverheadCache (std::size_t nEntries = 64, std::size_t maxKeySize = 0);
+
+  /**
+   * Get the entry associated with the given signature. On a cache miss, the
+   * entry the signature maps to is reset and associated with the signature.
+   * The returned reference stays valid until the next lookup.
+   *
+   * \param key the signature
+   * \return the entry associated with the given signature
+   */
+  Entry& Lookup (const std::vector<uint32_t>& key);
+  /**
+   * Remove all the entries from the cache.
+   */
+  void Clear (void);
+
+  /**
+   * \return the number of lookups that found the signature in the cache
+   */
+  uint64_t GetNHits (void) const;
+  /**
+   * \return the number of lookups that did not find the signature in the cache
+   */
+  uint64_t GetNMisses (void) const;
+
+private:
+  std::vector<Entry> m_entries;  //!< the cache entries
+  uint64_t m_nHits;              //!< number of cache hits
+  uint64_t m_nMisses;            //!< number of cache misses
+};
+
+} //namespace ns3
+
+#endif /* ACK_OVERHEAD_CACHE_H */
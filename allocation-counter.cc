@@ -0,0 +1,54 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "allocation-counter.h"
+
+namespace ns3 {
+
+AllocationScope::Counter AllocationScope::m_counter = 0;
+
+AllocationScope::AllocationScope (uint64_t& nAllocations)
+  : m_nAllocations (nAllocations),
+    m_start (GetNAllocations ())
+{
+}
+
+AllocationScope::~AllocationScope ()
+{
+  m_nAllocations += GetNAllocations () - m_start;
+}
+
+void
+AllocationScope::SetCounter (Counter counter)
+{
+  m_counter = counter;
+}
+
+bool
+AllocationScope::IsEnabled (void)
+{
+  return (m_counter != 0);
+}
+
+uint64_t
+AllocationScope::GetNAllocations (void)
+{
+  return (m_counter != 0 ? m_counter () : 0);
+}
+
+} //namespace ns3
@@ -0,0 +1,77 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * AllocationScope adds the number of heap allocations performed during its
+ * lifetime to a given counter. The library does not replace the global
+ * operator new, hence heap allocations are only counted once a function
+ * returning the number of heap allocations made so far is installed through
+ * SetCounter (e.g., by tests that replace the global operator new to check
+ * that scheduling decisions do not allocate memory). Otherwise, no allocation
+ * is counted.
+ */
+class AllocationScope
+{
+public:
+  /**
+   * Start counting heap allocations.
+   *
+   * \param nAllocations the counter incremented by the number of heap
+   *                     allocations when this object is destroyed
+   */
+  explicit AllocationScope (uint64_t& nAllocations);
+  ~AllocationScope ();
+
+  /// Function returning the number of heap allocations performed so far
+  typedef uint64_t (* Counter)(void);
+
+  /**
+   * Install the function used to get the number of heap allocations performed
+   * by the program so far.
+   *
+   * \param counter the function to install (null to stop counting)
+   */
+  static void SetCounter (Counter counter);
+  /**
+   * \return whether heap allocations are counted
+   */
+  static bool IsEnabled (void);
+  /**
+   * \return the number of heap allocations performed by the program so far
+   */
+  static uint64_t GetNAllocations (void);
+
+private:
+  uint64_t& m_nAllocations;  //!< the counter to update
+  uint64_t m_start;          //!< the number of heap allocations at construction
+
+  static Counter m_counter;  //!< the function returning the number of heap allocations
+};
+
+} //namespace ns3
+
+#endif /* ALLOCATION_COUNTER_H */
@@ -0,0 +1,200 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "buffer-status-estimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("BufferStatusEstimator");
+
+BufferStatusEstimator::BufferStatusEstimator (uint16_t maxAid)
+  : m_entries (maxAid + 1, {false, 0, Seconds (0), 0, 0.0}),
+    m_decayTime (MilliSeconds (50)),
+    m_rateTimeConstant (MilliSeconds (100)),
+    m_decayedSum (0.0),
+    m_sumTime (Seconds (0)),
+    m_rateSum (0.0),
+    m_rateTimeSum (0.0),
+    m_receivedSum (0),
+    m_nReports (0)
+{
+}
+
+void
+BufferStatusEstimator::SetDecayTime (Time decayTime)
+{
+  NS_ASSERT (decayTime.IsStrictlyPositive ());
+  m_decayTime = decayTime;
+  // the decayed sum depends on the time constant
+  RebuildSums ();
+}
+
+void
+BufferStatusEstimator::SetRateTimeConstant (Time rateTimeConstant)
+{
+  NS_ASSERT (rateTimeConstant.IsStrictlyPositive ());
+  m_rateTimeConstant = rateTimeConstant;
+}
+
+void
+BufferStatusEstimator::NotifyReceived (uint16_t aid, uint32_t bytes)
+{
+  NS_ASSERT (aid < m_entries.size ());
+  m_entries[aid].received += bytes;
+  if (m_entries[aid].valid)
+    {
+      m_receivedSum += bytes;
+    }
+}
+
+void
+BufferStatusEstimator::NotifyReport (uint16_t aid, uint32_t bytes, Time time)
+{
+  NS_LOG_FUNCTION (this << aid << bytes << time);
+  NS_ASSERT (aid < m_entries.size ());
+  Entry& entry = m_entries[aid];
+  UpdateSums (entry, false);
+
+  if (entry.valid && time > entry.reportTime)
+    {
+      // bytes that arrived at the station since the previous report
+      double elapsed = (time - entry.reportTime).GetSeconds ();
+      double arrived = std::max (0.0, static_cast<double> (bytes) + entry.received - entry.reported);
+      double alpha = 1 - std::exp (-elapsed / m_rateTimeConstant.GetSeconds ());
+      entry.arrivalRate += alpha * (arrived / elapsed - entry.arrivalRate);
+      NS_LOG_DEBUG ("Station " << aid << ": " << arrived << " bytes arrived in " << elapsed
+                    << "s, arrival rate " << entry.arrivalRate << " bytes/s");
+    }
+
+  entry.valid = true;
+  entry.reported = bytes;
+  entry.reportTime = time;
+  entry.received = 0;
+  UpdateSums (entry, true);
+}
+
+void
+BufferStatusEstimator::Reset (uint16_t aid)
+{
+  NS_ASSERT (aid < m_entries.size ());
+  UpdateSums (m_entries[aid], false);
+  m_entries[aid] = {false, 0, Seconds (0), 0, 0.0};
+}
+
+void
+BufferStatusEstimator::UpdateSums (const Entry& entry, bool add)
+{
+  if (!entry.valid)
+    {
+      return;
+    }
+  if (entry.reportTime > m_sumTime)
+    {
+      // move the reference time of the decayed sum forward, so that the decay
+      // factors of the single reports never exceed one
+      m_decayedSum *= std::exp (-(entry.reportTime - m_sumTime).GetSeconds () / m_decayTime.GetSeconds ());
+      m_sumTime = entry.reportTime;
+    }
+  double sign = (add ? 1.0 : -1.0);
+  m_decayedSum += sign * entry.reported
+                  * std::exp (-(m_sumTime - entry.reportTime).GetSeconds () / m_decayTime.GetSeconds ());
+  m_rateSum += sign * entry.arrivalRate;
+  m_rateTimeSum += sign * entry.arrivalRate * entry.reportTime.GetSeconds ();
+  if (add)
+    {
+      m_receivedSum += entry.received;
+      m_nReports++;
+    }
+  else
+    {
+      m_receivedSum -= entry.received;
+      m_nReports--;
+    }
+}
+
+void
+BufferStatusEstimator::RebuildSums (void)
+{
+  m_decayedSum = 0.0;
+  m_rateSum = 0.0;
+  m_rateTimeSum = 0.0;
+  m_receivedSum = 0;
+  m_nReports = 0;
+  for (const Entry& entry : m_entries)
+    {
+      UpdateSums (entry, true);
+    }
+}
+
+bool
+BufferStatusEstimator::HasReport (uint16_t aid) const
+{
+  NS_ASSERT (aid < m_entries.size ());
+  return m_entries[aid].valid;
+}
+
+uint32_t
+BufferStatusEstimator::GetReportedBytes (uint16_t aid) const
+{
+  NS_ASSERT (aid < m_entries.size ());
+  return m_entries[aid].reported;
+}
+
+double
+BufferStatusEstimator::GetArrivalRate (uint16_t aid) const
+{
+  NS_ASSERT (aid < m_entries.size ());
+  return m_entries[aid].arrivalRate;
+}
+
+uint32_t
+BufferStatusEstimator::GetEstimate (uint16_t aid, Time now) const
+{
+  NS_ASSERT (aid < m_entries.size ());
+  const Entry& entry = m_entries[aid];
+  NS_ASSERT (entry.valid);
+
+  double age = std::max (0.0, (now - entry.reportTime).GetSeconds ());
+  double estimate = entry.reported * std::exp (-age / m_decayTime.GetSeconds ())
+                    + entry.arrivalRate * age - static_cast<double> (entry.received);
+  return static_cast<uint32_t> (std::min (std::max (estimate, 0.0), 4294967294.0));
+}
+
+uint64_t
+BufferStatusEstimator::GetTotalEstimate (Time now) const
+{
+  // the sum of the estimates of the single stations, where the decay factor
+  // of each report is split into the factor up to m_sumTime and the common
+  // factor from m_sumTime to now
+  double age = std::max (0.0, (now - m_sumTime).GetSeconds ());
+  double estimate = m_decayedSum * std::exp (-age / m_decayTime.GetSeconds ())
+                    + m_rateSum * now.GetSeconds () - m_rateTimeSum - static_cast<double> (m_receivedSum);
+  return static_cast<uint64_t> (std::min (std::max (estimate, 0.0), m_nReports * 4294967294.0));
+}
+
+std::size_t
+BufferStatusEstimator::GetNReports (void) const
+{
+  return m_nReports;
+}
+
+} //namespace ns3
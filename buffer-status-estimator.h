@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BUFFER_STATUS_ESTIMATOR_H
+#define BUFFER_STATUS_ESTIMATOR_H
+
+#include "ns3/nstime.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * BufferStatusEstimator estimates the number of bytes buffered by each
+ * station (identified by its AID) from the buffer status reports it sent and
+ * the bytes received from it. Between two reports, a station buffers the
+ * bytes that arrived from the upper layers and releases the bytes it sent,
+ * hence the arrival rate of each station is learned as an exponentially
+ * weighted moving average of
+ *
+ *   (reported bytes - previously reported bytes + received bytes) / elapsed time
+ *
+ * The estimate of the bytes buffered by a station is the last reported value,
+ * which decays exponentially as the report ages, plus the bytes expected to
+ * have arrived since the report, minus the bytes received since the report.
+ * The sum of the estimates over all the stations is kept up to date as reports
+ * and received bytes are notified, so that it can be queried in constant time.
+ */
+class BufferStatusEstimator
+{
+public:
+  /**
+   * Create an estimator for the stations with AID up to the given value.
+   *
+   * \param maxAid the maximum AID
+   */
+  BufferStatusEstimator (uint16_t maxAid);
+
+  /**
+   * Set the time constant of the exponential decay of the reported values.
+   *
+   * \param decayTime the time constant of the decay of the reported values
+   */
+  void SetDecayTime (Time decayTime);
+  /**
+   * Set the time constant of the moving average of the arrival rate.
+   *
+   * \param rateTimeConstant the time constant of the moving average
+   */
+  void SetRateTimeConstant (Time rateTimeConstant);
+
+  /**
+   * Notify that the given number of bytes has been received from the given station.
+   *
+   * \param aid the AID of the station
+   * \param bytes the number of bytes received
+   */
+  void NotifyReceived (uint16_t aid, uint32_t bytes);
+  /**
+   * Notify that the given station reported the given number of buffered bytes
+   * at the given time. The arrival rate of the station is updated.
+   *
+   * \param aid the AID of the station
+   * \param bytes the number of buffered bytes
+   * \param time the time of the report
+   */
+  void NotifyReport (uint16_t aid, uint32_t bytes, Time time);
+  /**
+   * Forget about the given station.
+   *
+   * \param aid the AID of the station
+   */
+  void Reset (uint16_t aid);
+
+  /**
+   * \param aid the AID of the station
+   * \return whether the given station has sent a buffer status report
+   */
+  bool HasReport (uint16_t aid) const;
+  /**
+   * \param aid the AID of the station
+   * \return the number of buffered bytes last reported by the station
+   */
+  uint32_t GetReportedBytes (uint16_t aid) const;
+  /**
+   * \param aid the AID of the station
+   * \return the arrival rate (bytes/s) of the station
+   */
+  double GetArrivalRate (uint16_t aid) const;
+  /**
+   * \param aid the AID of the station
+   * \param now the current time
+   * \return the estimated number of bytes buffered by the station (never
+   *         negative, even if more bytes than expected were received)
+   */
+  uint32_t GetEstimate (uint16_t aid, Time now) const;
+  /**
+   * Get the estimated number of bytes buffered by all the stations that sent
+   * a report, in constant time. Differently from the sum of the estimates of
+   * the single stations, the stations that received more bytes than expected
+   * are not clamped at zero.
+   *
+   * \param now the current time
+   * \return the estimated number of bytes buffered by all the stations
+   */
+  uint64_t GetTotalEstimate (Time now) const;
+  /**
+   * \return the number of stations that sent a buffer status report
+   */
+  std::size_t GetNReports (void) const;
+
+private:
+  /// The state of a station
+  struct Entry
+  {
+    bool valid;           //!< whether the station has sent a report
+    uint32_t reported;    //!< the bytes reported by the last report
+    Time reportTime;      //!< the time of the last report
+    uint64_t received;    //!< the bytes received since the last report
+    double arrivalRate;   //!< the arrival rate (bytes/s)
+  };
+
+  /**
+   * Add the contribution of the given station to the sums over all the
+   * stations, or remove it.
+   *
+   * \param entry the state of the station
+   * \param add whether the contribution is added or removed
+   */
+  void UpdateSums (const Entry& entry, bool add);
+  /**
+   * Recompute the sums over all the stations from scratch.
+   */
+  void RebuildSums (void);
+
+  std::vector<Entry> m_entries;  //!< the state of the stations, indexed by AID
+  Time m_decayTime;              //!< time constant of the decay of the reported values
+  Time m_rateTimeConstant;       //!< time constant of the moving average of the arrival rate
+  double m_decayedSum;           //!< sum of the reported values, decayed up to m_sumTime
+  Time m_sumTime;                //!< the time m_decayedSum refers to
+  double m_rateSum;              //!< sum of the arrival rates (bytes/s)
+  double m_rateTimeSum;          //!< sum of the arrival rates times the report times (bytes)
+  uint64_t m_receivedSum;        //!< sum of the bytes received since the reports
+  std::size_t m_nReports;        //!< number of stations that sent a report
+};
+
+} //namespace ns3
+
+#endif /* BUFFER_STATUS_ESTIMATOR_H */
@@ -169,6 +169,8 @@ public:
   uint16_t m_channelCenterFrequency;
   uint16_t m_guardInterval; // GI in nanoseconds
   uint8_t m_maxNRus;        // max number of RUs per MU PPDU
+  std::string m_ruAllocation; // RU allocation mode (Heuristic/Optimal)
+  std::string m_schedulingPolicy; // scheduling policy (RoundRobin/ProportionalFair/EarliestDeadlineFirst)
   uint32_t m_mcs;           // MCS value
   uint16_t m_maxAmsduSize;  // maximum A-MSDU size
   uint32_t m_maxAmpduSize;  // maximum A-MSDU size
@@ -179,6 +181,8 @@ public:
   double m_dataRate;        // Mb/s
   uint16_t m_dlAckSeqType;
   bool m_continueTxop;
+  bool m_txopPlanning;
+  bool m_lookahead;
   uint16_t m_baBufferSize;
   std::string m_transport;
   std::string m_queueDisc;
@@ -261,6 +265,8 @@ WifiDlOfdmaExample::WifiDlOfdmaExample ()
     m_channelCenterFrequency (0),
     m_guardInterval (800),
     m_maxNRus (30),
+    m_ruAllocation ("Heuristic"),
+    m_schedulingPolicy ("RoundRobin"),
     m_mcs (11),
     m_maxAmsduSize (7500),
     m_maxAmpduSize (8388607u),
@@ -271,6 +277,8 @@ WifiDlOfdmaExample::WifiDlOfdmaExample ()
     m_dataRate (0),      // invalid value
     m_dlAckSeqType (2),
     m_continueTxop (false),
+    m_txopPlanning (false),
+    m_lookahead (false),
     m_baBufferSize (64),
     m_transport ("Tcp"),
     m_queueDisc ("default"),
@@ -313,12 +321,14 @@ WifiDlOfdmaExample::Config (int argc, char *argv[])
   cmd.AddValue ("radius", "Radius of the disc centered in the AP and containing all the non-AP STAs", m_radius);
   cmd.AddValue ("enableDlOfdma", "Enable/disable DL OFDMA", m_enableDlOfdma);
   cmd.AddValue ("forceDlOfdma", "The RR scheduler always returns DL OFDMA", m_forceDlOfdma);
-  cmd.AddValue ("dlAckType", "Ack sequence type for DL OFDMA (1-3)", m_dlAckSeqType);
+  cmd.AddValue ("dlAckType", "Ack sequence type for DL OFDMA (1-3, 0 to select it per PPDU)", m_dlAckSeqType);
   cmd.AddValue ("enableUlOfdma", "The RR scheduler returns UL OFDMA after DL OFDMA", m_enableUlOfdma);
   cmd.AddValue ("ulPsduSize", "Max size in bytes of HE TB PPDUs", m_ulPsduSize);
   cmd.AddValue ("channelWidth", "Channel bandwidth (20, 40, 80, 160)", m_channelWidth);
   cmd.AddValue ("guardInterval", "Guard Interval (800, 1600, 3200)", m_guardInterval);
   cmd.AddValue ("maxRus", "Maximum number of RUs allocated per DL MU PPDU", m_maxNRus);
+  cmd.AddValue ("ruAllocation", "RU allocation mode (Heuristic/Optimal)", m_ruAllocation);
+  cmd.AddValue ("schedulingPolicy", "Scheduling policy (RoundRobin/ProportionalFair/EarliestDeadlineFirst)", m_schedulingPolicy);
   cmd.AddValue ("mcs", "The constant MCS value to transmit HE PPDUs", m_mcs);
   cmd.AddValue ("maxAmsduSize", "Maximum A-MSDU size", m_maxAmsduSize);
   cmd.AddValue ("maxAmpduSize", "Maximum A-MPDU size", m_maxAmpduSize);
@@ -326,6 +336,8 @@ WifiDlOfdmaExample::Config (int argc, char *argv[])
   cmd.AddValue ("queueSize", "Maximum size of a WifiMacQueue (packets)", m_macQueueSize);
   cmd.AddValue ("msduLifetime", "Maximum MSDU lifetime in milliseconds", m_msduLifetime);
   cmd.AddValue ("continueTxop", "Continue TXOP if no SU response after MU PPDU", m_continueTxop);
+  cmd.AddValue ("txopPlanning", "Fill the TXOP with back-to-back DL MU PPDUs (implies continueTxop)", m_txopPlanning);
+  cmd.AddValue ("lookahead", "Plan the next DL MU PPDU while the current one is in flight", m_lookahead);
   cmd.AddValue ("baBufferSize", "Block Ack buffer size", m_baBufferSize);
 //   cmd.AddValue ("enableRts", "Enable or disable RTS/CTS", m_enableRts);
   cmd.AddValue ("dataRate", "Per-station data rate (Mb/s)", m_dataRate);
@@ -388,7 +400,11 @@ WifiDlOfdmaExample::Config (int argc, char *argv[])
             << "BA buffer size = " << m_baBufferSize << std::endl;
   if (m_enableDlOfdma)
     {
-      std::cout << "Ack sequence = " << m_dlAckSeqType << std::endl;
+      std::cout << "Ack sequence = " << m_dlAckSeqType << std::endl
+                << "RU allocation = " << m_ruAllocation << std::endl
+                << "Scheduling policy = " << m_schedulingPolicy << std::endl
+                << "TXOP planning = " << m_txopPlanning << std::endl
+                << "Lookahead = " << m_lookahead << std::endl;
     }
   else
     {
@@ -405,7 +421,12 @@ WifiDlOfdmaExample::Setup (void)
   Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", m_enableRts ? StringValue ("0") : StringValue ("999999"));
   Config::SetDefault ("ns3::HeConfiguration::GuardInterval", TimeValue (NanoSeconds (m_guardInterval)));
   Config::SetDefault ("ns3::WifiPhy::GuardInterval", TimeValue (NanoSeconds (m_guardInterval)));
-  Config::SetDefault ("ns3::RegularWifiMac::ContinueTxopIfNoSuResponseAfterMuPpdu", BooleanValue (m_continueTxop));
+  // the DL MU PPDUs planned for a TXOP are sent back-to-back only if the TXOP
+  // is continued after MU PPDUs not eliciting an SU response
+  Config::SetDefault ("ns3::RegularWifiMac::ContinueTxopIfNoSuResponseAfterMuPpdu",
+                      BooleanValue (m_continueTxop || (m_enableDlOfdma && m_txopPlanning)));
+  // WifiMacHelper::SetOfdmaManager takes at most eight attributes
+  Config::SetDefault ("ns3::RrOfdmaManager::Lookahead", BooleanValue (m_lookahead));
   Config::SetDefault ("ns3::ArpCache::AliveTimeout", TimeValue (Seconds (3600 * 24))); // ARP cache entries expire after one day
   Config::SetDefault ("ns3::WifiMacQueue::MaxQueueSize", QueueSizeValue (QueueSize (PACKETS, m_macQueueSize)));
   Config::SetDefault ("ns3::WifiMacQueue::MaxDelay", TimeValue (MilliSeconds (m_msduLifetime)));
@@ -438,6 +459,9 @@ WifiDlOfdmaExample::Setup (void)
                                 "ControlMode", StringValue (oss.str ()));
   switch (m_dlAckSeqType)
     {
+    case 0:
+      // the ack sequence is selected by the OFDMA manager
+      break;
     case 1:
       wifi.SetAckPolicySelectorForAc (AC_BE, "ns3::ConstantWifiAckPolicySelector",
                                       "DlAckSequenceType", UintegerValue (DlMuAckSequenceType::DL_SU_FORMAT));
@@ -451,7 +475,7 @@ WifiDlOfdmaExample::Setup (void)
                                       "DlAckSequenceType", UintegerValue (DlMuAckSequenceType::DL_AGGREGATE_TF));
       break;
     default:
-      NS_FATAL_ERROR ("Invalid DL ack sequence type (must be 1, 2 or 3)");
+      NS_FATAL_ERROR ("Invalid DL ack sequence type (must be 0, 1, 2 or 3)");
     }
 
   WifiMacHelper mac;
@@ -461,7 +485,12 @@ WifiDlOfdmaExample::Setup (void)
                            "NStations", UintegerValue (m_maxNRus),
                            "ForceDlOfdma", BooleanValue (m_forceDlOfdma),
                            "EnableUlOfdma", BooleanValue (m_enableUlOfdma),
-                           "UlPsduSize", UintegerValue (m_ulPsduSize));
+                           "UlPsduSize", UintegerValue (m_ulPsduSize),
+                           "RuAllocationMode", StringValue (m_ruAllocation),
+                           "SchedulingPolicy", StringValue (m_schedulingPolicy),
+                           "DlAckSequenceSelection", StringValue (m_dlAckSeqType == 0 ? "CostModel"
+                                                                                      : "AckPolicySelector"),
+                           "TxopPlanning", BooleanValue (m_txopPlanning));
     }
 
   mac.SetType ("ns3::StaWifiMac",
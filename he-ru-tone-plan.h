@@ -0,0 +1,311 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef HE_RU_TONE_PLAN_H
+#define HE_RU_TONE_PLAN_H
+
+#include "he-ru.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * Compile-time description of the HE tone plan for 20, 40, 80 and 160 MHz
+ * channels, meant to be indexed directly on the scheduling hot path.
+ *
+ * Every RU is described in terms of the 26-tone RUs it overlaps, which are
+ * called slots. Slots are numbered from 0 within each 80 MHz segment: an 80 MHz
+ * segment has 37 slots, i.e., four 20 MHz blocks of 9 slots each and the
+ * center 26-tone RU (slot 18) between the two 40 MHz halves. Each 20 MHz block
+ * is made of two halves of 4 slots, which can host a 106-tone RU each, and of
+ * the center 26-tone RU of the block (slot 4 of the block).
+ *
+ * RU indices follow the HeRu conventions: they start at 1 and, at 160 MHz,
+ * they are relative to the 80 MHz segment (primary or secondary) the RU
+ * belongs to. 20 and 40 MHz channels use the first slots of the segment, hence
+ * the same tables apply to every bandwidth.
+ */
+namespace HeRuTonePlan {
+
+/// Number of RU types (from 26-tone to 2x996-tone)
+constexpr std::size_t N_RU_TYPES = 7;
+
+/// Number of 26-tone slots in an 80 MHz segment
+constexpr std::size_t SLOTS_PER_SEGMENT = 37;
+
+/// Index of the center 26-tone RU of an 80 MHz segment
+constexpr std::size_t CENTER_SLOT_80MHZ = 18;
+
+/// Number of RUs of each type in an 80 MHz segment (or in the whole channel
+/// if narrower), for 20, 40, 80 and 160 MHz channels
+constexpr std::size_t N_RUS_PER_SEGMENT[4][N_RU_TYPES] = {
+  {9, 4, 2, 1, 0, 0, 0},
+  {18, 8, 4, 2, 1, 0, 0},
+  {37, 16, 8, 4, 2, 1, 0},
+  {37, 16, 8, 4, 2, 1, 1}
+};
+
+/// Number of slots overlapped by an RU of each type (2x996-tone RUs span two segments)
+constexpr std::size_t N_SLOTS[N_RU_TYPES] = {1, 2, 4, 9, 18, 37, 74};
+
+/// Offset of the first slot of each 52-tone RU within a 20 MHz block
+constexpr std::size_t RU52_OFFSET[4] = {0, 2, 5, 7};
+
+/**
+ * \param bandwidth the channel bandwidth in MHz (20, 40, 80 or 160)
+ * \return the row of the N_RUS_PER_SEGMENT table for the given bandwidth
+ */
+constexpr std::size_t
+GetBwIndex (uint16_t bandwidth)
+{
+  return (bandwidth <= 20 ? 0 : bandwidth == 40 ? 1 : bandwidth == 80 ? 2 : 3);
+}
+
+/**
+ * \param bandwidth the channel bandwidth in MHz
+ * \return the number of 80 MHz segments in the channel
+ */
+constexpr std::size_t
+GetNSegments (uint16_t bandwidth)
+{
+  return (bandwidth == 160 ? 2 : 1);
+}
+
+/**
+ * \param bandwidth the channel bandwidth in MHz
+ * \return the number of slots in the channel
+ */
+constexpr std::size_t
+GetNSlots (uint16_t bandwidth)
+{
+  return (bandwidth == 160 ? 2 * SLOTS_PER_SEGMENT : N_RUS_PER_SEGMENT[GetBwIndex (bandwidth)][HeRu::RU_26_TONE]);
+}
+
+/**
+ * \param ruType the RU type
+ * \return the number of slots overlapped by an RU of the given type
+ */
+constexpr std::size_t
+GetNSlots (HeRu::RuType ruType)
+{
+  return N_SLOTS[ruType];
+}
+
+/**
+ * \param bandwidth the channel bandwidth in MHz
+ * \param ruType the RU type
+ * \return the legal RU indices of the given type in an 80 MHz segment (or in
+ *         the whole channel if narrower) range from 1 to the returned value
+ */
+constexpr std::size_t
+GetNRusPerSegment (uint16_t bandwidth, HeRu::RuType ruType)
+{
+  return N_RUS_PER_SEGMENT[GetBwIndex (bandwidth)][ruType];
+}
+
+/**
+ * \param bandwidth the channel bandwidth in MHz
+ * \param ruType the RU type
+ * \return the number of RUs of the given type in the channel
+ */
+constexpr std::size_t
+GetNRus (uint16_t bandwidth, HeRu::RuType ruType)
+{
+  return (ruType == HeRu::RU_2x996_TONE ? GetNRusPerSegment (bandwidth, ruType)
+                                        : GetNSegments (bandwidth) * GetNRusPerSegment (bandwidth, ruType));
+}
+
+/**
+ * \param block the index (starting at 0) of a 20 MHz block in an 80 MHz segment
+ * \return the first slot of the given 20 MHz block
+ */
+constexpr std::size_t
+GetBlockFirstSlot (std::size_t block)
+{
+  // the blocks in the upper 40 MHz follow the center 26-tone RU of the segment
+  return 9 * block + (block >= 2 ? 1 : 0);
+}
+
+/**
+ * \param slot a slot of an 80 MHz segment other than the center one
+ * \return the index (starting at 0) of the 20 MHz block including the slot
+ */
+constexpr std::size_t
+GetBlock (std::size_t slot)
+{
+  return (slot < CENTER_SLOT_80MHZ ? slot / 9 : (slot - 1) / 9);
+}
+
+/**
+ * \param ruType the RU type
+ * \param index the RU index (starting at 1)
+ * \return the first slot (within its 80 MHz segment) overlapped by the RU
+ */
+constexpr std::size_t
+GetFirstSlot (HeRu::RuType ruType, std::size_t index)
+{
+  return (ruType == HeRu::RU_26_TONE ? index - 1
+          : ruType == HeRu::RU_52_TONE ? GetBlockFirstSlot ((index - 1) / 4) + RU52_OFFSET[(index - 1) % 4]
+          : ruType == HeRu::RU_106_TONE ? GetBlockFirstSlot ((index - 1) / 2) + 5 * ((index - 1) % 2)
+          : ruType == HeRu::RU_242_TONE ? GetBlockFirstSlot (index - 1)
+          : ruType == HeRu::RU_484_TONE ? (CENTER_SLOT_80MHZ + 1) * (index - 1)
+          : 0);
+}
+
+/**
+ * \param ruType the RU type
+ * \param index the RU index (starting at 1)
+ * \return the mask of the slots (within its 80 MHz segment) overlapped by
+ *         the RU. For 2x996-tone RUs, the mask of each of the two segments.
+ */
+constexpr uint64_t
+GetSlotMask (HeRu::RuType ruType, std::size_t index)
+{
+  return (ruType >= HeRu::RU_996_TONE ? (uint64_t (1) << SLOTS_PER_SEGMENT) - 1
+          : ((uint64_t (1) << N_SLOTS[ruType]) - 1) << GetFirstSlot (ruType, index));
+}
+
+/**
+ * \param index the index (starting at 1) of a 26-tone RU
+ * \return whether the 26-tone RU is the center RU of a 20 MHz block or of an
+ *         80 MHz segment, i.e., it is not part of any 52-tone RU
+ */
+constexpr bool
+IsCenter26ToneRu (std::size_t index)
+{
+  return (index - 1 == CENTER_SLOT_80MHZ
+          || index - 1 == GetBlockFirstSlot (GetBlock (index - 1)) + 4);
+}
+
+/**
+ * \param offset the offset of a slot within its 20 MHz block (other than the center one)
+ * \return the position (starting at 0) within the 20 MHz block of the 52-tone RU including the slot
+ */
+constexpr std::size_t
+GetRu52Offset (std::size_t offset)
+{
+  return (offset < 4 ? offset / 2 : (offset - 1) / 2);
+}
+
+/**
+ * \param ruType the RU type
+ * \param index the RU index (starting at 1)
+ * \return the type of the smallest RU including the given RU. The parent of
+ *         the center 26-tone RU of a 20 MHz block is the 242-tone RU of the
+ *         block, while the parent of the center 26-tone RU of an 80 MHz
+ *         segment is the 996-tone RU
+ */
+constexpr HeRu::RuType
+GetParentType (HeRu::RuType ruType, std::size_t index)
+{
+  return (ruType == HeRu::RU_26_TONE && index - 1 == CENTER_SLOT_80MHZ ? HeRu::RU_996_TONE
+          : ruType == HeRu::RU_26_TONE && IsCenter26ToneRu (index) ? HeRu::RU_242_TONE
+          : static_cast<HeRu::RuType> (ruType + 1));
+}
+
+/**
+ * \param ruType the RU type
+ * \param index the RU index (starting at 1)
+ * \return the index of the smallest RU including the given RU (whose type is
+ *         returned by GetParentType)
+ */
+constexpr std::size_t
+GetParentIndex (HeRu::RuType ruType, std::size_t index)
+{
+  return (ruType == HeRu::RU_26_TONE && index - 1 == CENTER_SLOT_80MHZ ? 1
+          : ruType == HeRu::RU_26_TONE && IsCenter26ToneRu (index) ? GetBlock (index - 1) + 1
+          : ruType == HeRu::RU_26_TONE
+            ? 4 * GetBlock (index - 1) + GetRu52Offset (index - 1 - GetBlockFirstSlot (GetBlock (index - 1))) + 1
+          : ruType >= HeRu::RU_484_TONE ? 1
+          : (index - 1) / 2 + 1);
+}
+
+/**
+ * \param ruType the RU type (larger than 26-tone)
+ * \param index the RU index (starting at 1)
+ * \return the index of the first of the two RUs of the next smaller type that
+ *         are included in the given RU. 242-tone and 996-tone RUs also include
+ *         a center 26-tone RU, whose index is returned by GetCenterChildIndex
+ */
+constexpr std::size_t
+GetFirstChildIndex (HeRu::RuType ruType, std::size_t index)
+{
+  return (ruType == HeRu::RU_52_TONE ? GetFirstSlot (ruType, index) + 1
+          : ruType == HeRu::RU_2x996_TONE ? 1
+          : 2 * (index - 1) + 1);
+}
+
+/**
+ * \param ruType the RU type (242-tone or 996-tone)
+ * \param index the RU index (starting at 1)
+ * \return the index of the center 26-tone RU included in the given RU
+ */
+constexpr std::size_t
+GetCenterChildIndex (HeRu::RuType ruType, std::size_t index)
+{
+  return (ruType == HeRu::RU_242_TONE ? GetBlockFirstSlot (index - 1) + 5 : CENTER_SLOT_80MHZ + 1);
+}
+
+/// Number of RU types that can be part of a 20 or 40 MHz layout (from 26-tone to 484-tone)
+constexpr std::size_t N_LAYOUT_RU_TYPES = 5;
+
+/// Maximum number of RUs in a 20 or 40 MHz layout
+constexpr std::size_t MAX_LAYOUT_RUS = 18;
+
+/// Maximum number of sub-multisets of the RUs of a 20 or 40 MHz layout (8 26-tone, 3 52-tone and 1 106-tone RUs)
+constexpr std::size_t MAX_LAYOUT_STATES = 72;
+
+/// Number of distinct RU layouts of a 20 MHz channel
+constexpr std::size_t N_LAYOUTS_20MHZ = 10;
+
+/// Number of distinct RU layouts of a 40 MHz channel
+constexpr std::size_t N_LAYOUTS_40MHZ = 36;
+
+/**
+ * Distinct layouts of a 20 MHz channel, i.e., the multisets of RUs that
+ * partition the channel. Each layout is given by the number of 26, 52, 106,
+ * 242 and 484-tone RUs it includes. Layouts with larger RUs come first.
+ */
+constexpr uint8_t RU_LAYOUTS_20MHZ[N_LAYOUTS_20MHZ][N_LAYOUT_RU_TYPES] = {
+  { 0,  0,  0,  1,  0}, { 1,  0,  2,  0,  0}, { 1,  2,  1,  0,  0}, { 3,  1,  1,  0,  0},
+  { 5,  0,  1,  0,  0}, { 1,  4,  0,  0,  0}, { 3,  3,  0,  0,  0}, { 5,  2,  0,  0,  0},
+  { 7,  1,  0,  0,  0}, { 9,  0,  0,  0,  0}
+};
+
+/**
+ * Distinct layouts of a 40 MHz channel (see RU_LAYOUTS_20MHZ), obtained by
+ * combining the layouts of the two 20 MHz halves or by a single 484-tone RU.
+ */
+constexpr uint8_t RU_LAYOUTS_40MHZ[N_LAYOUTS_40MHZ][N_LAYOUT_RU_TYPES] = {
+  { 0,  0,  0,  0,  1}, { 0,  0,  0,  2,  0}, { 1,  0,  2,  1,  0}, { 1,  2,  1,  1,  0},
+  { 3,  1,  1,  1,  0}, { 5,  0,  1,  1,  0}, { 1,  4,  0,  1,  0}, { 3,  3,  0,  1,  0},
+  { 5,  2,  0,  1,  0}, { 7,  1,  0,  1,  0}, { 9,  0,  0,  1,  0}, { 2,  0,  4,  0,  0},
+  { 2,  2,  3,  0,  0}, { 4,  1,  3,  0,  0}, { 6,  0,  3,  0,  0}, { 2,  4,  2,  0,  0},
+  { 4,  3,  2,  0,  0}, { 6,  2,  2,  0,  0}, { 8,  1,  2,  0,  0}, {10,  0,  2,  0,  0},
+  { 2,  6,  1,  0,  0}, { 4,  5,  1,  0,  0}, { 6,  4,  1,  0,  0}, { 8,  3,  1,  0,  0},
+  {10,  2,  1,  0,  0}, {12,  1,  1,  0,  0}, {14,  0,  1,  0,  0}, { 2,  8,  0,  0,  0},
+  { 4,  7,  0,  0,  0}, { 6,  6,  0,  0,  0}, { 8,  5,  0,  0,  0}, {10,  4,  0,  0,  0},
+  {12,  3,  0,  0,  0}, {14,  2,  0,  0,  0}, {16,  1,  0,  0,  0}, {18,  0,  0,  0,  0}
+};
+
+} //namespace HeRuTonePlan
+
+} //namespace ns3
+
+#endif /* HE_RU_TONE_PLAN_H */
@@ -19,11 +19,23 @@
  */
 
 #include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include "ns3/double.h"
+#include "ns3/simulator.h"
 #include "rr-ofdma-manager.h"
+#include "he-ru-tone-plan.h"
 #include "wifi-ack-policy-selector.h"
 #include "wifi-phy.h"
+#include "wifi-mac-queue.h"
+#include "block-ack-manager.h"
+#include "mpdu-aggregator.h"
+#include "allocation-counter.h"
 #include <utility>
 #include <algorithm>
+#include <functional>
+#include <sstream>
+#include <cmath>
 
 
 namespace ns3 {
@@ -32,6 +44,29 @@ NS_LOG_COMPONENT_DEFINE ("RrOfdmaManager");
 
 NS_OBJECT_ENSURE_REGISTERED (RrOfdmaManager);
 
+/// Maximum value of an Association ID
+static const uint16_t RR_OFDMA_MAX_AID = 2007;
+
+/// Maximum duration of an HE PPDU (aPPDUMaxTime) in microseconds
+static const uint16_t RR_OFDMA_PPDU_MAX_TIME_US = 5484;
+
+/// Scale factor applied to the proportional fair metric to get integer RU values
+static const double RR_OFDMA_PF_VALUE_SCALE = 1e6;
+
+/// Weight of the last TXOP in the share of TXOPs used for UL transmissions
+static const double RR_OFDMA_UL_SHARE_WEIGHT = 0.125;
+
+/// Weight of the last UL exchange in the measured trigger efficiency
+static const double RR_OFDMA_TRIGGER_EFFICIENCY_WEIGHT = 0.25;
+
+/// Number of words of the signature of a DL ack sequence preceding the per-user words
+static const std::size_t RR_OFDMA_ACK_KEY_HEADER = 3;
+
+/// Ack sequences for DL MU PPDUs, in the order they are counted
+static const DlMuAckSequenceType RR_OFDMA_DL_ACK_SEQUENCES[] = {DlMuAckSequenceType::DL_SU_FORMAT,
+                                                                 DlMuAckSequenceType::DL_MU_BAR,
+                                                                 DlMuAckSequenceType::DL_AGGREGATE_TF};
+
 TypeId
 RrOfdmaManager::GetTypeId (void)
 {
@@ -64,870 +99,2519 @@ RrOfdmaManager::GetTypeId (void)
                    UintegerValue (20),
                    MakeUintegerAccessor (&RrOfdmaManager::m_bw),
                    MakeUintegerChecker<uint16_t> (5, 160))
+    .AddAttribute ("TrafficClasses",
+                   "Traffic class of the stations, as a semicolon separated list of "
+                   "CLASS:FIRST-LAST entries, where CLASS is BulkSend, OnOff or Http and "
+                   "FIRST-LAST is a range of AIDs. The default value matches the stations "
+                   "set up by the example, which associate in order.",
+                   StringValue ("BulkSend:1-10;OnOff:11-15;Http:16-32"),
+                   MakeStringAccessor (&RrOfdmaManager::SetTrafficClassMap,
+                                       &RrOfdmaManager::GetTrafficClassMap),
+                   MakeStringChecker ())
+    .AddAttribute ("RuAllocationMode",
+                   "The algorithm used to assign RUs to the stations. Heuristic assigns RUs "
+                   "based on the traffic class of the stations, while Optimal assigns the RUs "
+                   "that maximize the bytes delivered in the DL MU PPDU given the backlog "
+                   "and the MCS of each station.",
+                   EnumValue (RU_ALLOC_HEURISTIC),
+                   MakeEnumAccessor (&RrOfdmaManager::m_ruAllocationMode),
+                   MakeEnumChecker (RU_ALLOC_HEURISTIC, "Heuristic",
+                                    RU_ALLOC_OPTIMAL, "Optimal"))
+    .AddAttribute ("SolverBudget",
+                   "The maximum number of state updates performed by the Optimal RU "
+                   "allocation for a single DL MU PPDU. If the budget does not allow to "
+                   "consider all the candidate stations, only the first ones are considered.",
+                   UintegerValue (500000),
+                   MakeUintegerAccessor (&RrOfdmaManager::m_solverBudget),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("SchedulingPolicy",
+                   "The policy used to select the stations to serve. RoundRobin serves the "
+                   "associated stations in turn, while ProportionalFair serves the stations "
+                   "with the highest ratio between instantaneous rate and average throughput "
+                   "and assigns the RUs that maximize the sum of such ratios. "
+                   "EarliestDeadlineFirst serves the stations whose head-of-line frames "
+                   "expire first and gives larger RUs to the most urgent stations.",
+                   EnumValue (SCHED_RR),
+                   MakeEnumAccessor (&RrOfdmaManager::m_schedulingPolicy),
+                   MakeEnumChecker (SCHED_RR, "RoundRobin",
+                                    SCHED_PF, "ProportionalFair",
+                                    SCHED_EDF, "EarliestDeadlineFirst"))
+    .AddAttribute ("PfTimeConstant",
+                   "The time constant of the exponentially weighted moving average of the "
+                   "throughput delivered to each station.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&RrOfdmaManager::m_pfTimeConstant),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("DeadlineWeight",
+                   "With earliest deadline first scheduling, the bytes a station can receive "
+                   "in an RU are weighted by 1 + DeadlineWeight * u, where u ranges from 0 "
+                   "(head-of-line frame just queued) to 1 (head-of-line frame about to expire).",
+                   DoubleValue (4.0),
+                   MakeDoubleAccessor (&RrOfdmaManager::m_deadlineWeight),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("SuTxInfoLifetime",
+                   "The time after which the mode and the number of spatial streams used to "
+                   "transmit single user frames to a station are queried again to the remote "
+                   "station manager. They are queried again earlier if a transmission to the "
+                   "station fails or the rate selected by the remote station manager changes. "
+                   "A zero value disables caching.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&RrOfdmaManager::m_suTxInfoLifetime),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("BsrDecayTime",
+                   "The time constant of the exponential decay of the buffer status last "
+                   "reported by a station, as the report ages.",
+                   TimeValue (MilliSeconds (50)),
+                   MakeTimeAccessor (&RrOfdmaManager::m_bsrDecayTime),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("BsrRateTimeConstant",
+                   "The time constant of the exponentially weighted moving average of the "
+                   "rate at which bytes arrive in the buffers of a station, which is learned "
+                   "from its buffer status reports and the bytes received from it.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&RrOfdmaManager::m_bsrRateTimeConstant),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("NumRaRus",
+                   "The number of 26-tone RUs of a Basic Trigger Frame dedicated to random "
+                   "access (UORA) by the associated stations, if some of the stations "
+                   "solicited by the Trigger Frame did not report their buffer status. Such "
+                   "stations are not assigned a dedicated RU and contend for the RA-RUs.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&RrOfdmaManager::m_nRaRus),
+                   MakeUintegerChecker<uint8_t> (0, 74))
+    .AddAttribute ("TxFormatSelection",
+                   "How the format of the next transmission is selected. Alternate tries an "
+                   "UL OFDMA transmission after every DL OFDMA transmission (if EnableUlOfdma "
+                   "is set). Adaptive tries an UL OFDMA transmission (if EnableUlOfdma is set) "
+                   "when UL transmissions have recently been given a smaller share of TXOPs than "
+                   "the share of the estimated UL backlog (weighted by the measured trigger "
+                   "efficiency) in the total backlog.",
+                   EnumValue (FORMAT_ALTERNATE),
+                   MakeEnumAccessor (&RrOfdmaManager::m_txFormatSelection),
+                   MakeEnumChecker (FORMAT_ALTERNATE, "Alternate",
+                                    FORMAT_ADAPTIVE, "Adaptive"))
+    .AddAttribute ("SingleStationSu",
+                   "If enabled (and ForceDlOfdma is not set), a single user transmission is "
+                   "selected instead of a DL MU PPDU when the AP has frames to send to a "
+                   "single station.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RrOfdmaManager::m_singleStationSu),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DlAckSequenceSelection",
+                   "How the ack sequence of DL MU PPDUs is selected. AckPolicySelector uses "
+                   "the ack sequence returned by the ack policy selector of the primary AC. "
+                   "CostModel selects, for every DL MU PPDU, the ack sequence that maximizes "
+                   "the goodput, given the RUs and the backlog of the receiver stations and "
+                   "the remaining TXOP.",
+                   EnumValue (ACK_SEQ_POLICY),
+                   MakeEnumAccessor (&RrOfdmaManager::m_dlAckSequenceSelection),
+                   MakeEnumChecker (ACK_SEQ_POLICY, "AckPolicySelector",
+                                    ACK_SEQ_COST_MODEL, "CostModel"))
+    .AddAttribute ("TxopPlanning",
+                   "If enabled, when a TXOP is won the backlogged stations are grouped into "
+                   "the DL MU PPDUs that fill the remaining TXOP, stations needing similar "
+                   "times being served by the same PPDU. The TXOP is continued after DL MU "
+                   "PPDUs only if the ContinueTxopIfNoSuResponseAfterMuPpdu attribute of the "
+                   "MAC is set.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RrOfdmaManager::m_txopPlanning),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Lookahead",
+                   "If enabled, the DL MU PPDU to send at the next channel access is planned "
+                   "right after a DL MU PPDU is handed over for transmission. The plan is "
+                   "committed if, in the meantime, the set of backlogged stations, the "
+                   "backlogged TIDs and the SU TX info of the planned stations and the BA "
+                   "agreements did not change and the next channel access starts a new TXOP "
+                   "(if TXOPs are used); otherwise, it is discarded.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RrOfdmaManager::m_lookahead),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TcpAckRatio",
+                   "The ratio between the bytes of the TCP acknowledgments a station is "
+                   "expected to send and the bytes of the bulk (BulkSend traffic class) flows "
+                   "it has been delivered. The expected acknowledgments are added to the estimated "
+                   "UL backlog of the station until it reports its buffer status again.",
+                   DoubleValue (0.03),
+                   MakeDoubleAccessor (&RrOfdmaManager::m_tcpAckRatio),
+                   MakeDoubleChecker<double> (0))
+    .AddTraceSource ("RaRuSuccess",
+                     "Frames from a single station were received in an RA-RU.",
+                     MakeTraceSourceAccessor (&RrOfdmaManager::m_raRuSuccessTrace),
+                     "ns3::RrOfdmaManager::RaRuSuccessCallback")
+    .AddTraceSource ("RaRuCollision",
+                     "Frames from multiple stations were received in an RA-RU.",
+                     MakeTraceSourceAccessor (&RrOfdmaManager::m_raRuCollisionTrace),
+                     "ns3::RrOfdmaManager::RaRuCollisionCallback")
   ;
   return tid;
 }
 
 RrOfdmaManager::RrOfdmaManager ()
-  : m_startStation (0)
+  : m_startStation (0),
+    m_trafficClass (RR_OFDMA_MAX_AID + 1, TC_UNCLASSIFIED),
+    m_nScratchAllocations (0),
+    m_scratchCapacity (0),
+    m_nDecisionAllocations (0),
+    m_nDecisions (0),
+    m_backlog (RR_OFDMA_MAX_AID + 1, 0),
+    m_nQueuedMpdus ((RR_OFDMA_MAX_AID + 1) * 8, 0),
+    m_nQueuedBytes ((RR_OFDMA_MAX_AID + 1) * 8, 0),
+    m_avgThroughput (RR_OFDMA_MAX_AID + 1, 0.0),
+    m_avgThroughputUpdate (RR_OFDMA_MAX_AID + 1, Seconds (0)),
+    m_holDeadline (RR_OFDMA_MAX_AID + 1, Seconds (0)),
+    m_staAddress (RR_OFDMA_MAX_AID + 1),
+    m_ringNext (RR_OFDMA_MAX_AID + 1, 0),
+    m_ringPrev (RR_OFDMA_MAX_AID + 1, 0),
+    m_activeStations ((RR_OFDMA_MAX_AID + 64) / 64, 0),
+    m_baTids (RR_OFDMA_MAX_AID + 1, 0),
+    m_barType ((RR_OFDMA_MAX_AID + 1) * 8, BlockAckReqType::COMPRESSED),
+    m_baType ((RR_OFDMA_MAX_AID + 1) * 8, BlockAckType::COMPRESSED),
+    m_suTxInfo (RR_OFDMA_MAX_AID + 1, {WifiMode (), 1, Seconds (0), 0}),
+    m_suTxInfoEpoch (1),
+    m_nSuTxInfoHits (0),
+    m_nSuTxInfoMisses (0),
+    m_bsrEstimator (RR_OFDMA_MAX_AID),
+    m_bsrReportTime (RR_OFDMA_MAX_AID + 1, Seconds (0)),
+    m_ulUnlimited (RR_OFDMA_MAX_AID + 1, 0),
+    m_nUlUnlimited (0),
+    m_backlogTracesConnected (false),
+    m_raRuPending (false),
+    m_predictedAckBytes (RR_OFDMA_MAX_AID + 1, 0.0),
+    m_predictedAckTotal (0.0),
+    m_bulkMpduSize (RR_OFDMA_MAX_AID + 1, 0),
+    m_ulSolicited (RR_OFDMA_MAX_AID + 1, 0),
+    m_ulPending (false),
+    m_nUlResponded (0),
+    m_triggerEfficiency (1.0),
+    m_ulServedShare (0.0),
+    m_dlAckOverhead (64, RR_OFDMA_ACK_KEY_HEADER + 2 * (HeRuTonePlan::GetNRus (160, HeRu::RU_26_TONE) + 1)),
+    m_dlTxopRemaining (Seconds (0)),
+    m_nDlAckSequences (sizeof (RR_OFDMA_DL_ACK_SEQUENCES) / sizeof (RR_OFDMA_DL_ACK_SEQUENCES[0]), 0),
+    m_txopPlanStart (Seconds (-1)),
+    m_nextTxopSlot (0),
+    m_txopPlanNextStart (0),
+    m_txopSlotMember (RR_OFDMA_MAX_AID + 1, 0),
+    m_nTxopPlans (0),
+    m_nPlannedPpdus (0),
+    m_dlStateVersion (0),
+    m_lookaheadMember (RR_OFDMA_MAX_AID + 1, 0),
+    m_lookaheadValid (false),
+    m_lookaheadFormat (OfdmaTxFormat::NON_OFDMA),
+    m_lookaheadTid (0),
+    m_lookaheadVersion (0),
+    m_lookaheadSuTxInfoEpoch (0),
+    m_nLookaheadHits (0),
+    m_nLookaheadMisses (0)
 {
   NS_LOG_FUNCTION (this);
+  // Reserve the scratch storage used to rank candidates, so that no allocation
+  // is needed while taking scheduling decisions
+  std::size_t maxCandidates = HeRuTonePlan::GetNRus (160, HeRu::RU_26_TONE) + 1;
+  m_candidates.Reserve (maxCandidates);
+  m_ranking.reserve (maxCandidates);
+  m_ruAssigned.reserve (maxCandidates);
+  m_rankingScratch.reserve (maxCandidates);
+  m_candidateOrder.reserve (maxCandidates);
+  m_topStations.reserve (maxCandidates);
+  m_ruValues.reserve (maxCandidates * HeRuTonePlan::N_RU_TYPES);
+  m_layoutChoice.reserve (maxCandidates * HeRuTonePlan::MAX_LAYOUT_STATES);
+  m_ulStations.reserve (maxCandidates);
+  m_raRus.reserve (maxCandidates);
+  m_dlAckKey.reserve (RR_OFDMA_ACK_KEY_HEADER + 2 * maxCandidates);
+  m_txopPlanAids.reserve (RR_OFDMA_MAX_AID);
+  m_txopPlanDemand.reserve (RR_OFDMA_MAX_AID);
+  m_txopPlanEntries.reserve (RR_OFDMA_MAX_AID);
+  m_txopSlots.reserve (RR_OFDMA_MAX_AID);
+  m_dlPlan.nStations = 0;
+  m_dlPlan.planned = false;
+  m_dlPlan.newTxopPlan = false;
+  // the plans made in advance are computed in the storage of m_lookaheadState
+  m_lookaheadState.dlPlan = m_dlPlan;
+  m_lookaheadState.candidates.Reserve (maxCandidates);
+  m_lookaheadState.ranking.reserve (maxCandidates);
+  m_lookaheadState.txopPlanAids.reserve (RR_OFDMA_MAX_AID);
+  m_lookaheadState.txopPlanDemand.reserve (RR_OFDMA_MAX_AID);
+  m_lookaheadState.txopSlots.reserve (RR_OFDMA_MAX_AID);
+  m_ulOverhead.ackSequence = UL_MULTI_STA_BLOCK_ACK;
+  m_ulOverhead.channelWidth = 0;
+  m_ulOverhead.guardInterval = 0;
+  // indexed by the number of solicited stations and the number of RA-RUs
+  m_ulOverhead.nRaRuValues = maxCandidates + 1;
+  m_ulOverhead.overhead.resize ((maxCandidates + 1) * m_ulOverhead.nRaRuValues, Seconds (-1));
+  m_triggerHdr.SetType (WIFI_MAC_CTL_TRIGGER);
+  m_triggerHdr.SetAddr1 (Mac48Address::GetBroadcast ());
+  m_triggerPayload = Create<Packet> ();
+  m_scratchCapacity = GetScratchCapacity ();
 }
 
 RrOfdmaManager::~RrOfdmaManager ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+  m_lookaheadEvent.Cancel ();
 }
 
 void
-RrOfdmaManager::InitTxVectorAndParams (std::map<Mac48Address, DlPerStaInfo> staList,
-                                        std::vector<std::pair<HeRu::RuType,size_t>> ruAssigned, DlMuAckSequenceType dlMuAckSequence)
+RrOfdmaManager::SetTrafficClass (uint16_t aid, TrafficClass trafficClass)
 {
-  NS_LOG_FUNCTION (this);
-  m_txVector = WifiTxVector ();
-  m_txVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
-  m_txVector.SetChannelWidth (m_low->GetPhy ()->GetChannelWidth ());
-  m_txVector.SetGuardInterval (m_low->GetPhy ()->GetGuardInterval ().GetNanoSeconds ());
-  m_txVector.SetTxPowerLevel (GetWifiRemoteStationManager ()->GetDefaultTxPowerLevel ());
-  m_txParams = MacLowTransmissionParameters ();
-  m_txParams.SetDlMuAckSequenceType (dlMuAckSequence);
+  NS_LOG_FUNCTION (this << aid << +trafficClass);
+  NS_ABORT_MSG_IF (aid > RR_OFDMA_MAX_AID, "Invalid AID: " << aid);
+  m_trafficClass[aid] = trafficClass;
+  m_dlStateVersion++;
+}
 
-  Ptr<WifiMacQueueItem> mpdu = Copy (m_mpdu);
-  auto ruIt=ruAssigned.begin();
-  for (auto& sta : staList)
-    {if(ruIt==ruAssigned.end()){break;}
-      mpdu->GetHeader ().SetAddr1 (sta.first);
-      // Get the TX vector used to transmit single user frames to the receiver
-      // station (the RU index will be assigned by ComputeDlOfdmaInfo)
-      WifiTxVector suTxVector = m_low->GetDataTxVector (mpdu);
-      NS_LOG_DEBUG ("Adding STA with AID=" << sta.second.aid << " and TX mode="
-                    << suTxVector.GetMode () << " to the TX vector" << staList.size() << ruAssigned.size());
-
-      m_txVector.SetHeMuUserInfo (sta.second.aid, {{false, ruIt->first, 1}, suTxVector.GetMode (), suTxVector.GetNss ()});
-
-      // Add the receiver station to the appropriate list of the TX params
-      Ptr<QosTxop> txop = m_qosTxop[QosUtilsMapTidToAc (sta.second.tid)];
-      BlockAckReqType barType = txop->GetBaAgreementEstablished (sta.first, sta.second.tid)
-                                ? txop->GetBlockAckReqType (sta.first, sta.second.tid)
-                                : BlockAckReqType::COMPRESSED;
-      BlockAckType baType = txop->GetBaAgreementEstablished (sta.first, sta.second.tid)
-                            ? txop->GetBlockAckType (sta.first, sta.second.tid)
-                            : BlockAckType::COMPRESSED;
+RrOfdmaManager::TrafficClass
+RrOfdmaManager::GetTrafficClass (uint16_t aid) const
+{
+  return (aid <= RR_OFDMA_MAX_AID ? m_trafficClass[aid] : TC_UNCLASSIFIED);
+}
 
-      if (dlMuAckSequence == DlMuAckSequenceType::DL_SU_FORMAT)
-        {
-          // Enable BAR/BA exchange for all the receiver stations
-          m_txParams.EnableBlockAckRequest (sta.first, barType, baType);
-        }
-      else if (dlMuAckSequence == DlMuAckSequenceType::DL_MU_BAR)
-        {
-          // Send a MU-BAR to all the stations
-          m_txParams.EnableBlockAckRequest (sta.first, barType, baType);
-        }
-      else if (dlMuAckSequence == DlMuAckSequenceType::DL_AGGREGATE_TF)
-        {
-          // Expect to receive a Block Ack from all the stations
-          m_txParams.EnableBlockAck (sta.first, baType);
-        }
-        ruIt++;
-    }
+double
+RrOfdmaManager::GetAverageThroughput (uint16_t aid) const
+{
+  NS_ABORT_MSG_IF (aid > RR_OFDMA_MAX_AID, "Invalid AID: " << aid);
+  // the average is decayed lazily, i.e., only when it is read or updated
+  Time elapsed = Simulator::Now () - m_avgThroughputUpdate[aid];
+  return m_avgThroughput[aid] * std::exp (-elapsed.GetSeconds () / m_pfTimeConstant.GetSeconds ());
 }
 
-OfdmaTxFormat
-RrOfdmaManager::SelectTxFormat (Ptr<const WifiMacQueueItem> mpdu)
+void
+RrOfdmaManager::UpdateAverageThroughput (uint16_t aid, uint64_t bytes)
 {
-  // --- for TESTING only ---
-//   for (uint8_t i = 1; i <= m_nStations; i++)
-//     {
-//       DlPerStaInfo info {i, 0};
-//       m_staInfo.push_back (std::make_pair (Mac48Address::Allocate (), info));
-//     }
-//   return OfdmaTxFormat::DL_OFDMA;
-  // --- --- ---
-  NS_LOG_FUNCTION (this << *mpdu);
-  NS_ASSERT (mpdu->GetHeader ().IsQosData ());
+  NS_LOG_FUNCTION (this << aid << bytes);
+  NS_ABORT_MSG_IF (aid > RR_OFDMA_MAX_AID, "Invalid AID: " << aid);
+  m_avgThroughput[aid] = GetAverageThroughput (aid) + bytes / m_pfTimeConstant.GetSeconds ();
+  m_avgThroughputUpdate[aid] = Simulator::Now ();
+}
 
-  if (m_enableUlOfdma && GetTxFormat () == DL_OFDMA)
-    {
-      // check if an UL OFDMA transmission is possible after a DL OFDMA transmission
-      NS_ABORT_MSG_IF (m_ulPsduSize == 0, "The UlPsduSize attribute must be set to a non-null value");
+void
+RrOfdmaManager::SetTrafficClassMap (std::string classes)
+{
+  NS_LOG_FUNCTION (this << classes);
 
-      Ptr<QosTxop> txop = m_qosTxop[QosUtilsMapTidToAc (mpdu->GetHeader ().GetQosTid ())];
-      m_ulMuAckSequence = txop->GetAckPolicySelector ()->GetAckSequenceForUlMu ();
-      MacLowTransmissionParameters params;
-      params.SetUlMuAckSequenceType (m_ulMuAckSequence);
-      BlockAckType baType;
+  std::fill (m_trafficClass.begin (), m_trafficClass.end (), TC_UNCLASSIFIED);
+  m_trafficClassMap = classes;
 
-      if (m_ulMuAckSequence == UL_MULTI_STA_BLOCK_ACK)
+  std::istringstream iss (classes);
+  std::string entry;
+  while (std::getline (iss, entry, ';'))
+    {
+      if (entry.empty ())
         {
-          baType = BlockAckType::MULTI_STA;
-          for (auto& userInfo : m_txVector.GetHeMuUserInfoMap ())
-            {
-              auto addressIt = m_apMac->GetStaList ().find (userInfo.first);
-              if (addressIt != m_apMac->GetStaList ().end ())
-                {
-                  baType.m_bitmapLen.push_back (32);
-                  params.EnableBlockAck (addressIt->second, baType);
-                }
-              else
-                {
-                  NS_LOG_WARN ("Maybe station with AID=" << userInfo.first << " left the BSS since the last MU DL transmission?");
-                }
-            }
+          continue;
         }
-      else
+      std::size_t colon = entry.find (':');
+      NS_ABORT_MSG_IF (colon == std::string::npos, "Invalid traffic class entry: " << entry);
+
+      std::string name = entry.substr (0, colon);
+      TrafficClass trafficClass;
+      if (name == "BulkSend")
         {
-          NS_FATAL_ERROR ("Sending Block Acks in an MU DL PPDU is not supported yet");
+          trafficClass = TC_BULK_SEND;
         }
-
-      CtrlTriggerHeader trigger (TriggerFrameType::BASIC_TRIGGER, m_txVector);
-
-      // compute the maximum amount of time that can be granted to stations.
-      // This value is limited by the max PPDU duration
-      Time maxDuration = GetPpduMaxTime (m_txVector.GetPreambleType ());
-
-      // compute the time required by stations based on the buffer status reports, if any
-      uint32_t maxBufferSize = 0;
-
-      for (auto& userInfo : m_txVector.GetHeMuUserInfoMap ())
+      else if (name == "OnOff")
         {
-          auto addressIt = m_apMac->GetStaList ().find (userInfo.first);
-          if (addressIt != m_apMac->GetStaList ().end ())
-            {
-              uint8_t queueSize = m_apMac->GetMaxBufferStatus (addressIt->second);
-              if (queueSize == 255)
-                {
-                  NS_LOG_DEBUG ("Buffer status of station " << addressIt->second << " is unknown");
-                  maxBufferSize = std::max (maxBufferSize, m_ulPsduSize);
-                }
-              else if (queueSize == 254)
-                {
-                  NS_LOG_DEBUG ("Buffer status of station " << addressIt->second << " is not limited");
-                  maxBufferSize = 0xffffffff;
-                  break;
-                }
-              else
-                {
-                  NS_LOG_DEBUG ("Buffer status of station " << addressIt->second << " is " << +queueSize);
-                  maxBufferSize = std::max (maxBufferSize, static_cast<uint32_t> (queueSize * 256));
-                }
-            }
-          else
-            {
-              NS_LOG_WARN ("Maybe station with AID=" << userInfo.first << " left the BSS since the last MU DL transmission?");
-            }
+          trafficClass = TC_ON_OFF;
         }
-
-      // if the maximum buffer size is 0, skip UL OFDMA and proceed with trying DL OFDMA
-      if (maxBufferSize > 0)
+      else if (name == "Http")
         {
-          // if we are within a TXOP, we have to consider the response time and the
-          // remaining TXOP duration
-          if (txop->GetTxopLimit ().IsStrictlyPositive ())
-            {
-              // we need to define the HE TB PPDU duration in order to compute the response to
-              // the Trigger Frame. Let's use 1 ms for this purpose. We'll subtract it later.
-              uint16_t length = WifiPhy::ConvertHeTbPpduDurationToLSigLength (MilliSeconds (1),
-                                                                              m_low->GetPhy ()->GetFrequency ());
-              trigger.SetUlLength (length);
+          trafficClass = TC_HTTP;
+        }
+      else
+        {
+          NS_FATAL_ERROR ("Unknown traffic class: " << name);
+        }
 
-              Ptr<Packet> packet = Create<Packet> ();
-              packet->AddHeader (trigger);
-              WifiMacHeader hdr;
-              hdr.SetType (WIFI_MAC_CTL_TRIGGER);
-              hdr.SetAddr1 (Mac48Address::GetBroadcast ());
-              Ptr<WifiMacQueueItem> item = Create<WifiMacQueueItem> (packet, hdr);
+      std::string range = entry.substr (colon + 1);
+      auto parseAid = [&range] (const std::string& str) -> uint16_t
+        {
+          std::istringstream aidIss (str);
+          uint32_t aid;
+          aidIss >> aid;
+          NS_ABORT_MSG_IF (aidIss.fail () || !aidIss.eof () || aid > RR_OFDMA_MAX_AID,
+                           "Invalid AID range: " << range);
+          return static_cast<uint16_t> (aid);
+        };
+      std::size_t dash = range.find ('-');
+      uint16_t first = parseAid (range.substr (0, dash));
+      uint16_t last = (dash == std::string::npos ? first : parseAid (range.substr (dash + 1)));
+      NS_ABORT_MSG_IF (first > last, "Invalid AID range: " << range);
+
+      for (uint16_t aid = first; aid <= last; aid++)
+        {
+          m_trafficClass[aid] = trafficClass;
+        }
+    }
+}
 
-              Time response = m_low->GetResponseDuration (params, m_txVector, item);
+std::string
+RrOfdmaManager::GetTrafficClassMap (void) const
+{
+  return m_trafficClassMap;
+}
 
-              // Add the time to transmit the Trigger Frame itself
-              WifiTxVector txVector = GetWifiRemoteStationManager ()->GetRtsTxVector (hdr.GetAddr1 (), &hdr, packet);
+void
+RrOfdmaManager::ConnectBacklogTraces (void)
+{
+  NS_LOG_FUNCTION (this);
 
-              response += m_low->GetPhy ()->CalculateTxDuration (item->GetSize (), txVector,
-                                                                 m_low->GetPhy ()->GetFrequency ());
+  // Expired MSDUs are removed from the queue through the same function used to
+  // dequeue MSDUs, hence the Dequeue trace also accounts for expired MSDUs
+  for (uint8_t ac = 0; ac < 4; ac++)
+    {
+      std::vector<Ptr<WifiMacQueue>> queues {m_qosTxop[ac]->GetWifiMacQueue (),
+                                             m_qosTxop[ac]->GetBaManager ()->GetRetransmitQueue ()};
+      for (auto& queue : queues)
+        {
+          queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&RrOfdmaManager::NotifyEnqueue, this));
+          queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&RrOfdmaManager::NotifyDequeue, this));
+        }
+    }
 
-              // Subtract the duration of the HE TB PPDU
-              response -= WifiPhy::ConvertLSigLengthToHeTbPpduDuration (length, m_txVector,
-                                                                        m_low->GetPhy ()->GetFrequency ());
+  m_apMac->TraceConnectWithoutContext ("AssociatedSta", MakeCallback (&RrOfdmaManager::NotifyAssociation, this));
+  m_apMac->TraceConnectWithoutContext ("DeAssociatedSta", MakeCallback (&RrOfdmaManager::NotifyDisassociation, this));
+  // TCP acknowledgments are only expected for the segments delivered to the stations
+  m_apMac->TraceConnectWithoutContext ("TxOkHeader", MakeCallback (&RrOfdmaManager::NotifyTxOk, this));
 
-              if (response > txop->GetTxopRemaining ())
-                {
-                  // an UL OFDMA transmission is not possible. Reset m_staInfo and return DL_OFDMA.
-                  // In this way, no transmission will occur now and the next time we will try again
-                  // performing an UL OFDMA transmission.
-                  NS_LOG_DEBUG ("Remaining TXOP duration is not enough for UL MU exchange");
-                  m_dataInfo.clear();
-                  m_staInfo.clear ();
-                  // ruAssigned.clear();
-                  // ruIndexValues.clear();
-                  return DL_OFDMA;
-                }
+  // Block Ack agreements are tracked through the Block Ack managers. Agreements
+  // torn down by a DELBA frame are not notified, but transmissions to the station
+  // then fail and its agreements are refreshed when the MPDUs are dropped
+  for (uint8_t ac = 0; ac < 4; ac++)
+    {
+      m_qosTxop[ac]->GetBaManager ()->TraceConnectWithoutContext ("AgreementState",
+                                                                  MakeCallback (&RrOfdmaManager::NotifyAgreementState, this));
+    }
+  GetWifiRemoteStationManager ()->TraceConnectWithoutContext ("MacTxFinalDataFailed",
+                                                              MakeCallback (&RrOfdmaManager::NotifyTxFinalDataFailed, this));
+
+  // The cached SU TX info of a station is discarded when a transmission to the
+  // station fails and, for the remote station managers that trace the selected
+  // rate (e.g., Ideal), the cached SU TX info of all stations is discarded when
+  // such rate changes
+  GetWifiRemoteStationManager ()->TraceConnectWithoutContext ("MacTxDataFailed",
+                                                              MakeCallback (&RrOfdmaManager::NotifyTxDataFailed, this));
+  GetWifiRemoteStationManager ()->TraceConnectWithoutContext ("Rate",
+                                                              MakeCallback (&RrOfdmaManager::NotifyRateChange, this));
+
+  // The buffer status reports are carried by the QoS frames received from the
+  // stations, which are also used to learn the arrival rate of each station
+  m_bsrEstimator.SetDecayTime (m_bsrDecayTime);
+  m_bsrEstimator.SetRateTimeConstant (m_bsrRateTimeConstant);
+  m_low->GetPhy ()->TraceConnectWithoutContext ("MonitorSnifferRx",
+                                                MakeCallback (&RrOfdmaManager::NotifyMonitorSnifferRx, this));
+
+  // Initialize the backlog index with the frames already queued
+  for (auto& sta : m_apMac->GetStaList ())
+    {
+      InitBacklog (sta.first, sta.second);
+    }
+  m_backlogTracesConnected = true;
+}
 
-              maxDuration = Min (maxDuration, txop->GetTxopRemaining () - response);
-            }
+void
+RrOfdmaManager::InitBacklog (uint16_t aid, Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << aid << address);
+  NS_ABORT_MSG_IF (aid == 0 || aid > RR_OFDMA_MAX_AID, "Invalid AID: " << aid);
 
-          Time bufferTxTime = m_low->GetPhy ()->CalculateTxDuration (maxBufferSize, m_txVector,
-                                                                     m_low->GetPhy ()->GetFrequency (),
-                                                                     trigger.begin ()->GetAid12 ());
-          if (bufferTxTime < maxDuration)
-            {
-              // the maximum buffer size can be transmitted within the allowed time
-              maxDuration = bufferTxTime;
-            }
-          else
+  m_aidMap[address] = aid;
+  m_staAddress[aid] = address;
+  m_backlog[aid] = 0;
+  for (uint8_t tid = 0; tid < 8; tid++)
+    {
+      Ptr<QosTxop> txop = m_qosTxop[QosUtilsMapTidToAc (tid)];
+      uint32_t& nQueued = m_nQueuedMpdus[aid * 8 + tid];
+      uint32_t& nBytes = m_nQueuedBytes[aid * 8 + tid];
+      nQueued = 0;
+      nBytes = 0;
+      for (auto& queue : {txop->GetWifiMacQueue (), txop->GetBaManager ()->GetRetransmitQueue ()})
+        {
+          for (auto it = queue->PeekByTidAndAddress (tid, address); it != queue->end ();
+               it = queue->PeekByTidAndAddress (tid, address, ++it))
             {
-              // maxDuration may be a too short time. If it does not allow to transmit
-              // at least m_ulPsduSize bytes, give up the UL MU transmission for now
-              Time minDuration = m_low->GetPhy ()->CalculateTxDuration (m_ulPsduSize, m_txVector,
-                                                                        m_low->GetPhy ()->GetFrequency (),
-                                                                        trigger.begin ()->GetAid12 ());
-              if (maxDuration < minDuration)
-                {
-                  // maxDuration is a too short time. Reset m_staInfo and return DL_OFDMA.
-                  // In this way, no transmission will occur now and the next time we will try again
-                  // performing an UL OFDMA transmission.
-                  NS_LOG_DEBUG ("Available time " << maxDuration << " is too short");
-                  m_dataInfo.clear();
-                  m_staInfo.clear ();
-                  // ruAssigned.clear();
-                  // ruIndexValues.clear();
-                  return DL_OFDMA;
-                }
+              nQueued++;
+              nBytes += (*it)->GetPacket ()->GetSize ();
             }
-
-          // maxDuration is the time to grant to the stations. Store it in the TX vector
-          NS_LOG_DEBUG ("HE TB PPDU duration: " << maxDuration.ToDouble (Time::MS));
-          uint16_t length = WifiPhy::ConvertHeTbPpduDurationToLSigLength (maxDuration,
-                                                                          m_low->GetPhy ()->GetFrequency ());
-          m_txVector.SetLength (length);
-          m_txParams = params;
-          return UL_OFDMA;
+        }
+      if (nQueued > 0)
+        {
+          m_backlog[aid] |= (1 << tid);
         }
     }
+  UpdateActiveStation (aid);
+  RefreshBaState (aid, address);
 
-  // get the list of associated stations ((AID, MAC address) pairs)
-  const std::map<uint16_t, Mac48Address>& staList = m_apMac->GetStaList ();
-  auto startIt = staList.find (m_startStation);
-
-  // This may be the first invocation or the starting station left
-  if (startIt == staList.end ())
+  // the station may have reported its buffer status before being tracked
+  if (m_apMac->GetMaxBufferStatus (address) != 255)
     {
-      startIt = staList.begin ();
-      m_startStation = startIt->first;
+      m_bsrReportTime[aid] = Simulator::Now ();
+      ReadBufferStatus (aid, address);
     }
+}
 
-  uint8_t currTid = mpdu->GetHeader ().GetQosTid ();
-  AcIndex primaryAc = QosUtilsMapTidToAc (currTid);
-  m_dataInfo.clear();
-  // ruIndexValues.clear();
-  // ruAssigned.clear();
-  m_staInfo.clear ();
-
-  // If the primary AC holds a TXOP, we can select a station as a receiver of
-  // the MU PPDU only if the AP has frames to send to such station that fit into
-  // the remaining TXOP time. To this end, we need to determine the type of ack
-  // sequence and the time it takes. To compute the latter, we can call the
-  // MacLow::GetResponseDuration () method, which requires TX vector and TX params.
-  // Our best guess at this stage is that the AP has frames to send to all the
-  // associated stations and hence we initialize the TX vector and the TX params
-  // by considering the starting station and those that immediately follow it in
-  // the list of associated stations.
-  std::size_t count = m_nStations;
- std::vector<std::pair<HeRu::RuType,size_t>> ruType = GetNumberAndTypeOfRus (m_low->GetPhy ()->GetChannelWidth (), count,m_staInfo);
-  NS_ASSERT (count >= 1);
+void
+RrOfdmaManager::NotifyAssociation (uint16_t aid, Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << aid << address);
+  InitBacklog (aid, address);
+}
 
-  std::map<Mac48Address, DlPerStaInfo> guess;
-  auto staIt = startIt;
-  do
+void
+RrOfdmaManager::NotifyDisassociation (uint16_t aid, Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << aid << address);
+  if (aid == 0 || aid > RR_OFDMA_MAX_AID)
     {
-      guess[staIt->second] = {staIt->first, currTid};
-      if (++staIt == staList.end ())
-        {
-          staIt = staList.begin ();
-        }
-    } while (guess.size () < count && staIt != startIt);
-
-  Ptr<WifiAckPolicySelector> ackSelector = m_qosTxop[primaryAc]->GetAckPolicySelector ();
-  NS_ASSERT (ackSelector != 0);
-  m_dlMuAckSequence = ackSelector->GetAckSequenceForDlMu ();
-  InitTxVectorAndParams (guess, ruType, m_dlMuAckSequence);
-
-  // if the AC owns a TXOP, compute the time available for the transmission of data frames
-  Time txopLimit = Seconds (0);
-  if (m_qosTxop[primaryAc]->GetTxopLimit ().IsStrictlyPositive ())
+      return;
+    }
+  // frames still queued for the station are no longer tracked
+  m_aidMap.erase (address);
+  m_backlog[aid] = 0;
+  for (uint8_t tid = 0; tid < 8; tid++)
     {
-      // TODO Account for MU-RTS/CTS when implemented
-      CtrlTriggerHeader trigger;
-
-      if (m_dlMuAckSequence == DlMuAckSequenceType::DL_MU_BAR
-          || m_dlMuAckSequence == DlMuAckSequenceType::DL_AGGREGATE_TF)
-        {
-          // Need to prepare the MU-BAR to correctly get the response time
-          trigger = GetTriggerFrameHeader (m_txVector, 5);
-          trigger.SetUlLength (m_low->CalculateUlLengthForBlockAcks (trigger, m_txParams));
-        }
-      txopLimit = m_qosTxop[primaryAc]->GetTxopRemaining () - GetResponseDuration (m_txParams, m_txVector, trigger);
+      m_nQueuedMpdus[aid * 8 + tid] = 0;
+      m_nQueuedBytes[aid * 8 + tid] = 0;
+      SetBaState (aid, address, tid, false);
+    }
+  UpdateActiveStation (aid);
+  m_bsrEstimator.Reset (aid);
+  m_bsrReportTime[aid] = Seconds (0);
+  SetUlUnlimited (aid, false);
+  m_predictedAckTotal -= m_predictedAckBytes[aid];
+  m_predictedAckBytes[aid] = 0;
+}
 
-      if (txopLimit.IsNegative ())
-        {
-          if (m_forceDlOfdma)
-            {
-              NS_LOG_DEBUG ("Not enough TXOP remaining time: return DL_OFDMA with empty set of receiver stations");
-              return OfdmaTxFormat::DL_OFDMA;
-            }
-          NS_LOG_DEBUG ("Not enough TXOP remaining time: return NON_OFDMA");
-          return OfdmaTxFormat::NON_OFDMA;
-        }
+void
+RrOfdmaManager::SetBaState (uint16_t aid, Mac48Address address, uint8_t tid, bool established)
+{
+  NS_LOG_FUNCTION (this << aid << address << +tid << established);
+  std::size_t index = aid * 8 + tid;
+  uint8_t baTids = m_baTids[aid];
+  BlockAckReqType barType = m_barType[index];
+  BlockAckType baType = m_baType[index];
+  if (established)
+    {
+      Ptr<QosTxop> txop = m_qosTxop[QosUtilsMapTidToAc (tid)];
+      m_baTids[aid] |= (1 << tid);
+      m_barType[index] = txop->GetBlockAckReqType (address, tid);
+      m_baType[index] = txop->GetBlockAckType (address, tid);
+    }
+  else
+    {
+      m_baTids[aid] &= ~(1 << tid);
+      m_barType[index] = BlockAckReqType::COMPRESSED;
+      m_baType[index] = BlockAckType::COMPRESSED;
+    }
+  if (m_baTids[aid] != baTids || m_barType[index].m_variant != barType.m_variant
+      || m_baType[index].m_variant != baType.m_variant
+      || m_baType[index].m_bitmapLen != baType.m_bitmapLen)
+    {
+      m_dlStateVersion++;
     }
+}
 
-  // iterate over the associated stations until an enough number of stations is identified
-  do
+void
+RrOfdmaManager::RefreshBaState (uint16_t aid, Mac48Address address)
+{
+  for (uint8_t tid = 0; tid < 8; tid++)
     {
-      NS_LOG_DEBUG ("Next candidate STA (MAC=" << startIt->second << ", AID=" << startIt->first << ")");
-      // check if the AP has at least one frame to be sent to the current station
-      auto ruIt=ruType.begin();
-      for (uint8_t tid : std::initializer_list<uint8_t> {currTid, 1, 2, 0, 3, 4, 5, 6, 7})
-        {
-          AcIndex ac = QosUtilsMapTidToAc (tid);
-          // check that a BA agreement is established with the receiver for the
-          // considered TID, since ack sequences for DL MU PPDUs require block ack
-          if (ac >= primaryAc && m_qosTxop[ac]->GetBaAgreementEstablished (startIt->second, tid))
-            {
-              Ptr<const WifiMacQueueItem> mpdu;
-              mpdu = m_qosTxop[ac]->PeekNextFrame (tid, startIt->second);
+      SetBaState (aid, address, tid,
+                  m_qosTxop[QosUtilsMapTidToAc (tid)]->GetBaAgreementEstablished (address, tid));
+    }
+}
 
-              // we only check if the first frame of the current TID meets the size
-              // and duration constraints. We do not explore the queues further.
-              if (mpdu != 0)
-                {
-                  // Use a temporary TX vector including only the STA-ID of the
-                  // candidate station to check if the MPDU meets the size and time limits.
-                  // An RU of the computed size is tentatively assigned to the candidate
-                  // station, so that the TX duration can be correctly computed.
-                  WifiTxVector suTxVector = m_low->GetDataTxVector (mpdu),
-                               muTxVector;
-
-                  muTxVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
-                  muTxVector.SetChannelWidth (m_low->GetPhy ()->GetChannelWidth ());
-                  muTxVector.SetGuardInterval (m_low->GetPhy ()->GetGuardInterval ().GetNanoSeconds ());
-                  muTxVector.SetHeMuUserInfo (startIt->first,
-                                              {{false, ruIt->first, 1}, suTxVector.GetMode (), suTxVector.GetNss ()});
-
-                  if (m_low->IsWithinSizeAndTimeLimits (mpdu, muTxVector, 0, txopLimit))
-                    {
-                      // the frame meets the constraints, add the station to the list
-                      NS_LOG_DEBUG ("Adding candidate STA (MAC=" << startIt->second << ", AID="
-                                    << startIt->first << ") TID=" << +tid);
-                      
-                      DlPerStaInfo info {startIt->first, tid};
-   
-                      m_dataInfo.push_back(std::make_tuple (startIt->second,mpdu->GetPacket()->GetSize(),info));
-                      m_staInfo.push_back (std::make_pair (startIt->second, info));
-                      
-                      break;    // terminate the for loop
-                    }
-                }
-              else
-                {
-                  NS_LOG_DEBUG ("No frames to send to " << startIt->second << " with TID=" << +tid);
-                }
-            }
-            ruIt++;
-        }
+void
+RrOfdmaManager::NotifyAgreementState (Time now, Mac48Address recipient, uint8_t tid,
+                                      OriginatorBlockAckAgreement::State state)
+{
+  uint16_t aid = GetAid (recipient);
+  if (aid == 0 || aid > RR_OFDMA_MAX_AID)
+    {
+      return;
+    }
+  SetBaState (aid, recipient, tid, state == OriginatorBlockAckAgreement::ESTABLISHED);
+}
 
-      // move to the next station in the map
-      startIt++;
-      if (startIt == staList.end ())
-        {
-          startIt = staList.begin ();
-        }
-    } while (m_staInfo.size () < m_nStations && startIt->first != m_startStation);
+void
+RrOfdmaManager::NotifyTxFinalDataFailed (Mac48Address address)
+{
+  uint16_t aid = GetAid (address);
+  if (aid == 0 || aid > RR_OFDMA_MAX_AID)
+    {
+      return;
+    }
+  RefreshBaState (aid, address);
+  m_suTxInfo[aid].epoch = 0;
+  if (m_lookaheadMember[aid])
+    {
+      m_dlStateVersion++;
+    }
+}
 
-  if (m_staInfo.empty ())
+void
+RrOfdmaManager::NotifyTxDataFailed (Mac48Address address)
+{
+  uint16_t aid = GetAid (address);
+  if (aid != 0 && aid <= RR_OFDMA_MAX_AID)
     {
-      if (m_forceDlOfdma)
+      m_suTxInfo[aid].epoch = 0;
+      if (m_lookaheadMember[aid])
         {
-          NS_LOG_DEBUG ("The AP does not have suitable frames to transmit: return DL_OFDMA with empty set of receiver stations");
-          return OfdmaTxFormat::DL_OFDMA;
+          m_dlStateVersion++;
         }
-      NS_LOG_DEBUG ("The AP does not have suitable frames to transmit: return NON_OFDMA");
-      return OfdmaTxFormat::NON_OFDMA;
     }
+}
 
-  m_startStation = startIt->first;
-  return OfdmaTxFormat::DL_OFDMA;
+void
+RrOfdmaManager::NotifyRateChange (uint64_t oldRate, uint64_t newRate)
+{
+  // entries stamped with a previous epoch are no longer valid
+  m_suTxInfoEpoch++;
 }
-void 
-RrOfdmaManager::merge(std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>>& v, int p, int q, int r) 
+
+bool
+RrOfdmaManager::IsActiveStation (uint16_t aid) const
 {
-    int size1 = q-p+1;
-    int size2 = r-q;
-    std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>> L(size1);
-    std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>> R(size2);
+  return (m_activeStations[aid / 64] >> (aid % 64)) & 1;
+}
 
-    for(int i = 0; i < size1; i++)
+void
+RrOfdmaManager::UpdateActiveStation (uint16_t aid)
+{
+  bool active = (m_backlog[aid] != 0);
+  if (active == IsActiveStation (aid))
     {
-        L[i] = v[p+i];
+      return;
     }
-    for(int j = 0; j < size2; j++)
-    {
-        R[j]=v[q+j+1];
-    }
-
-    int i=0,j=0;
-    int k;
-    for(k = p; k <= r && i < size1 && j < size2; k++)
-    {
-        if(std::get<1>(L[i]) >= std::get<1>(R[j]))
-        {
-            v[k] = L[i];
-            i++;
-        }
-        else
-        {
-            v[k] = R[j];
-            j++;
-        }
-    }
-    for(i = i; i < size1; ++i)
-    {
-        v[k] = L[i];
-        k++;
-    }
-
-    for(j = j; j < size2; j++)
-    {
-        v[k] = R[j];
-        k++;
-    }
-}
-void 
-RrOfdmaManager::merge_sort(std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>>& v, int p, int r) 
-{
-    if(p < r)
-    {
-        int q = (p+r)/2;
-        merge_sort(v, p, q);
-        merge_sort(v, q+1, r);
-        merge(v, p, q, r);
-    }
-}
-char* 
-RrOfdmaManager::decToHexa(int n) 
-{    
-    // char array to store hexadecimal number 
-    char hexaDeciNum[100]; 
-      
-    // counter for hexadecimal number array 
-    int i = 0; 
-    while(n!=0) 
-    {    
-        // temporary variable to store remainder 
-        int temp  = 0; 
-          
-        // storing remainder in temp variable. 
-        temp = n % 16; 
-          
-        // check if temp < 10 
-        if(temp < 10) 
-        { 
-            hexaDeciNum[i] = temp + 48; 
-            i++; 
-        } 
-        else
-        { 
-            hexaDeciNum[i] = temp + 55; 
-            i++; 
-        } 
-          
-        n = n/16; 
-    } 
-char array[]="0:0:0:0:0:";
-   char *s=new char[10+i];
-      strcpy(s, array);    
-    // printing hexadecimal number array in reverse order 
-      int u=10;
-    for(int j=i-1; j>=0; j--)
-    { 
-      s[u++]=hexaDeciNum[j];
-    }
-    return s;
-} 
-std::vector<std::pair<HeRu::RuType,size_t>>
-RrOfdmaManager::GetNumberAndTypeOfRus (uint16_t bandwidth, std::size_t& nStations,std::list<std::pair<Mac48Address, DlPerStaInfo>> m_staInfo)
-{
-    //onoff 2-16
- //   //bulksend 17-21
- //   //http 22-32
-  // NS_LOG_FUNCTION (this);
-
-  HeRu::RuType ruType;
-  uint8_t nRusAssigned = 0;
-  std::vector<std::pair<HeRu::RuType,size_t>> ruAssigned;
-  std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>> onoff;
-  std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>> bulksend;
-  std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>> http;
-
-  auto staInfoIt = m_dataInfo.begin ();
- 
-  int size1=(int)m_dataInfo.size();
-  for (int i = 0; i < size1; i++)
-  {
-    // NS_ASSERT (staInfoIt != m_staInfo.end ());
-    // printf("here" );
-    // char add[6];
-    // 
-    int flag=0;
-   
- 
-    // Mac48Address *mac=new Mac48Address("0:0:0:0:0:2");
-
-  // NS_LOG_DEBUG ("MAC ADDRESS are " << std::get<0>(*staInfoIt) << std::get<1>(*staInfoIt)<<" here") ;
-     auto b1 = bulksend1.begin ();
- 
-      for(int i=0;i<(int)bulksend1.size();i++)
-      {
-        if(*b1==std::get<0>(*staInfoIt)){bulksend.push_back(*staInfoIt);flag=1;break;}
-        b1++;
-      }
-      if(flag==0)
-      {
-        b1 = onoff1.begin ();
-        for(auto i=0;i<(int)onoff1.size();i++)
-      {
-        if(*b1==std::get<0>(*staInfoIt)){onoff.push_back(*staInfoIt);flag=1;break;}
-        b1++;
-      }
-    }
-      if(flag==0)
-      {
-        b1 = http1.begin ();
-        for(auto i=0;i<(int)http1.size();i++)
-      {
-        if(*b1==std::get<0>(*staInfoIt)){http.push_back(*staInfoIt);flag=1;break;}
-        b1++;
-      }
-      }
-      NS_LOG_DEBUG("flag value "<<flag <<std::get<0>(*staInfoIt));
-    staInfoIt++;
-  }
-  int size2=onoff.size();
-  merge_sort(onoff,0,size2-1);
-  int size3=bulksend.size();
-  merge_sort(bulksend,0,size3-1);
-  int size4=http.size();
-  merge_sort(http,0,size4-1);
-  if(size3 ==0 ||(size2+size3+size4<=1))
-  {
-    // iterate over all the available RU types
-    NS_LOG_DEBUG(size1 <<" "<<size2<<" "<< size3<<" "<< size4);
-    for (auto& ru : HeRu::m_heRuSubcarrierGroups)
-      {
-        if (ru.first.first == bandwidth && ru.second.size () <=nStations)
-          {
-            ruType = ru.first.second;
-            nRusAssigned = ru.second.size ();
-            break;
-          }
-        else if (bandwidth == 160 && ru.first.first == 80 && (2 * ru.second.size ()) <= nStations)
-          {
-            ruType = ru.first.second;
-            nRusAssigned = 2 * ru.second.size ();
-            break;
-          }
-      }
-    if (nRusAssigned == 0)
-      {
-        NS_ASSERT (bandwidth == 160 && nStations == 1);
-        nRusAssigned = 1;
-        ruType = HeRu::RU_2x996_TONE;
-      }
-    m_dataInfo.clear();
-    staInfoIt = onoff.begin ();
-    for(int i=0;i<size2;i++){m_dataInfo.push_back(*staInfoIt);staInfoIt++;}
-    staInfoIt = bulksend.begin ();
-    for(int i=0;i<size3;i++){m_dataInfo.push_back(*staInfoIt);staInfoIt++;}
-    staInfoIt = http.begin ();
-    for(int i=0;i<size4;i++){m_dataInfo.push_back(*staInfoIt);staInfoIt++;}
-    for (std::size_t ruIndex = 1; ruIndex <= HeRu::m_heRuSubcarrierGroups.at ({bandwidth, ruType}).size (); ruIndex++)
-    {
-      ruAssigned.push_back(std::make_pair(ruType,ruIndex));
-    }
-    // nStations = nRusAssigned;
-    // NS_LOG_DEBUG("here before");
-    return ruAssigned;
-  }
-
-  else 
-  {
- 
-  
-      if(size2>7)
-      {
-        m_dataInfo.clear();
-        staInfoIt = onoff.begin ();
-
-        for(int i=0;i<size2;i++){m_dataInfo.push_back(*staInfoIt);staInfoIt++;}
-
-        staInfoIt = bulksend.begin ();
-
-        for(int i=0;i<size2;i++){m_dataInfo.push_back(*staInfoIt);staInfoIt++;}
-        
-        staInfoIt = http.begin ();
-        
-        for(int i=0;i<size4;i++){m_dataInfo.push_back(*staInfoIt);staInfoIt++;}
-        
-        for (auto& ru : HeRu::m_heRuSubcarrierGroups)
-        {
-
-
-          ruType = ru.first.second;
-          nRusAssigned = ru.second.size ();
-          break;
+  // the round robin order changes
+  m_dlStateVersion++;
 
-        }
-        for (std::size_t ruIndex = 1; ruIndex <= HeRu::m_heRuSubcarrierGroups.at ({bandwidth, ruType}).size (); ruIndex++)
+  if (active)
+    {
+      // the ring is kept sorted by AID: link the station before its successor
+      uint16_t next = FindActiveStation (aid);
+      if (next < aid)
         {
-          ruAssigned.push_back(std::make_pair(ruType,ruIndex));
+          // no active station has a greater AID, hence link before the sentinel
+          next = 0;
         }
-      // nRusAssigned=size2;
-
-      return ruAssigned;
+      uint16_t prev = m_ringPrev[next];
+      m_ringNext[prev] = aid;
+      m_ringPrev[aid] = prev;
+      m_ringNext[aid] = next;
+      m_ringPrev[next] = aid;
+      m_activeStations[aid / 64] |= (uint64_t (1) << (aid % 64));
     }
-    else
+  else
     {
-        int allocated106=0;
-        int allocated52=0;
-        int allocated26=size2;
-        int a=242-26*size2;
-        if(a>=106 && size3>0){allocated106+=1;a=a-106;size3-=1;}
+      m_ringNext[m_ringPrev[aid]] = m_ringNext[aid];
+      m_ringPrev[m_ringNext[aid]] = m_ringPrev[aid];
+      m_ringNext[aid] = m_ringPrev[aid] = 0;
+      m_activeStations[aid / 64] &= ~(uint64_t (1) << (aid % 64));
+    }
+}
 
-        while(a>=52 && size3>0)
-        {
-          a-=52;
-          allocated52+=1;
-          size3-=1;
-          
-        }
-        while(a>=26 && size4>0)
+uint16_t
+RrOfdmaManager::FindActiveStation (uint16_t aid) const
+{
+  // look for the first active station with an AID not less than the given one
+  for (std::size_t word = aid / 64; word < m_activeStations.size (); word++)
+    {
+      uint64_t bits = m_activeStations[word];
+      if (word == aid / 64)
         {
-          a-=26;
-          allocated26+=1;
-          size4-=1;
+          bits &= ~uint64_t (0) << (aid % 64);
         }
-   
-        
-        
-        nRusAssigned=allocated106+allocated26+allocated52;
-        NS_LOG_DEBUG("HERE "<< allocated52 <<" "<<allocated26 <<" "<<allocated106<< "before "<<m_dataInfo.size());
-        size2=(int)onoff.size();
-        size3=(int)bulksend.size();
-        size4=(int)http.size();
-        m_dataInfo.clear();
-        auto staInfoIt1=onoff.begin();
-        auto staInfoIt2=bulksend.begin();
-        auto staInfoIt3=http.begin();
-        HeRu::RuType type1=table.at("RU_106_TONE");
-        HeRu::RuType type2=table.at("RU_52_TONE");
-        HeRu::RuType type3=table.at("RU_26_TONE");
-
-        if(allocated106>0){m_dataInfo.push_back(*staInfoIt2);staInfoIt2++;ruAssigned.push_back(std::make_pair(type1,1));size3-=1;}
-        else 
+      if (bits != 0)
         {
-          m_dataInfo.push_back(*staInfoIt2);
-          
-          size3-=1;
-          allocated52-=1;
-          staInfoIt2++;
-          ruAssigned.push_back(std::make_pair(type2,1)); 
-          int u=2;
-          size_t in=3;
-          while(size2>0 &&u>0)
-            {
-              m_dataInfo.push_back(*staInfoIt1);
-              staInfoIt1++;size2-=1;u-=1;
-              ruAssigned.push_back(std::make_pair(type3,in++)); 
-              // ruAssigned.push_back(type3);
-              // ruIndexValues.push_back(in++);
-            }
-           while(size4>0 &&u>0)
-            {
-              m_dataInfo.push_back(*staInfoIt3);
-              staInfoIt3++;u-=1;
-              size4-=1;
-              ruAssigned.push_back(std::make_pair(type3,in++)); 
-              // ruAssigned.push_back(type3);
-              // ruIndexValues.push_back(in++);
-            }
+          return static_cast<uint16_t> (word * 64 + __builtin_ctzll (bits));
         }
-        if(allocated26%2!=0)
-        {
-          if(size2>0)
-          {
-            m_dataInfo.push_back(*staInfoIt1);staInfoIt1++;
+    }
+  // wrap around: the first active station, if any, follows the sentinel
+  return m_ringNext[0];
+}
 
-            size2-=1;
-          }
-          else
-          {
-            m_dataInfo.push_back(*staInfoIt3);staInfoIt3++;
-            size4-=1;
-          }
-          allocated26-=1;
-          ruAssigned.push_back(std::make_pair(type3,5)); 
-          // ruAssigned.push_back(type3);
-          // ruIndexValues.push_back(5);
-        }
-        size_t in1=3;
-        size_t in2=6;
-        if(allocated52>0){in2=8;}
-        while(allocated52>0)
+uint16_t
+RrOfdmaManager::GetNextActiveStation (uint16_t aid) const
+{
+  if (!IsActiveStation (aid))
+    {
+      return FindActiveStation (aid + 1);
+    }
+  // skip the sentinel
+  return (m_ringNext[aid] != 0 ? m_ringNext[aid] : m_ringNext[0]);
+}
+
+uint16_t
+RrOfdmaManager::GetAid (Mac48Address address)
+{
+  auto it = m_aidMap.find (address);
+  if (it != m_aidMap.end ())
+    {
+      return it->second;
+    }
+  // the station may have associated after the map was last updated
+  for (auto& sta : m_apMac->GetStaList ())
+    {
+      m_aidMap[sta.second] = sta.first;
+      m_staAddress[sta.first] = sta.second;
+    }
+  it = m_aidMap.find (address);
+  return (it != m_aidMap.end () ? it->second : 0);
+}
+
+void
+RrOfdmaManager::NotifyEnqueue (Ptr<const WifiMacQueueItem> item)
+{
+  UpdateBacklog (item, true);
+}
+
+void
+RrOfdmaManager::NotifyDequeue (Ptr<const WifiMacQueueItem> item)
+{
+  UpdateBacklog (item, false);
+}
+
+void
+RrOfdmaManager::NotifyTxOk (const WifiMacHeader& hdr)
+{
+  if (!hdr.IsQosData () || hdr.GetAddr1 ().IsGroup ())
+    {
+      return;
+    }
+
+  uint16_t aid = GetAid (hdr.GetAddr1 ());
+  if (aid == 0 || aid > RR_OFDMA_MAX_AID || GetTrafficClass (aid) != TC_BULK_SEND)
+    {
+      return;
+    }
+  // the station is expected to acknowledge the TCP segments it receives
+  double ackBytes = m_bulkMpduSize[aid] * m_tcpAckRatio;
+  m_predictedAckBytes[aid] += ackBytes;
+  m_predictedAckTotal += ackBytes;
+}
+
+void
+RrOfdmaManager::UpdateBacklog (Ptr<const WifiMacQueueItem> item, bool enqueued)
+{
+  const WifiMacHeader& hdr = item->GetHeader ();
+  if (!hdr.IsQosData () || hdr.GetAddr1 ().IsGroup ())
+    {
+      return;
+    }
+
+  uint16_t aid = GetAid (hdr.GetAddr1 ());
+  if (aid == 0 || aid > RR_OFDMA_MAX_AID)
+    {
+      return;
+    }
+
+  uint8_t tid = hdr.GetQosTid ();
+  uint8_t backlog = m_backlog[aid];
+  uint32_t& nQueued = m_nQueuedMpdus[aid * 8 + tid];
+  uint32_t& nBytes = m_nQueuedBytes[aid * 8 + tid];
+  uint32_t size = item->GetPacket ()->GetSize ();
+  if (enqueued)
+    {
+      nQueued++;
+      nBytes += size;
+    }
+  else if (nQueued > 0)
+    {
+      nQueued--;
+      nBytes = (nQueued > 0 && nBytes > size ? nBytes - size : 0);
+      if (GetTrafficClass (aid) == TC_BULK_SEND)
+        {
+          // the acknowledged MPDUs are only notified by their header
+          m_bulkMpduSize[aid] = size;
+        }
+    }
+
+  if (nQueued > 0)
+    {
+      m_backlog[aid] |= (1 << tid);
+    }
+  else
+    {
+      m_backlog[aid] &= ~(1 << tid);
+    }
+  UpdateActiveStation (aid);
+  if (m_backlog[aid] != backlog && m_lookaheadMember[aid])
+    {
+      // the TIDs of a candidate of the DL MU PPDU planned in advance changed
+      m_dlStateVersion++;
+    }
+}
+
+void
+RrOfdmaManager::InitTxVectorAndParams (const std::vector<HeRu::RuSpec>& ruAssigned,
+                                       DlMuAckSequenceType dlMuAckSequence)
+{
+  NS_LOG_FUNCTION (this);
+  m_txVector = WifiTxVector ();
+  m_txVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
+  m_txVector.SetChannelWidth (m_low->GetPhy ()->GetChannelWidth ());
+  m_txVector.SetGuardInterval (m_low->GetPhy ()->GetGuardInterval ().GetNanoSeconds ());
+  m_txVector.SetTxPowerLevel (GetWifiRemoteStationManager ()->GetDefaultTxPowerLevel ());
+  m_txParams = MacLowTransmissionParameters ();
+  m_txParams.SetDlMuAckSequenceType (dlMuAckSequence);
+  // the header of the signature is completed by LookupDlAckOverhead
+  m_dlAckKey.assign (RR_OFDMA_ACK_KEY_HEADER, 0);
+
+  // the i-th ranked candidate is assigned the i-th RU
+  for (std::size_t i = 0; i < std::min (m_ranking.size (), ruAssigned.size ()); i++)
+    {
+      uint16_t c = m_ranking[i];
+      const Mac48Address& address = m_candidates.address[c];
+      DlPerStaInfo info {m_candidates.aid[c], m_candidates.tid[c]};
+      NS_LOG_DEBUG ("Adding STA with AID=" << info.aid << " and TX mode="
+                    << m_candidates.mode[c] << " to the TX vector, assigned " << ruAssigned[i]);
+
+      m_txVector.SetHeMuUserInfo (info.aid, {ruAssigned[i], m_candidates.mode[c], m_candidates.nss[c]});
+
+      // Add the receiver station to the appropriate list of the TX params. The
+      // BAR and BA types are compressed if no agreement is established
+      const BlockAckReqType& barType = m_barType[info.aid * 8 + info.tid];
+      const BlockAckType& baType = m_baType[info.aid * 8 + info.tid];
+
+      m_dlAckKey.push_back ((static_cast<uint32_t> (ruAssigned[i].ruType) << 24)
+                            | (static_cast<uint32_t> (m_candidates.nss[c]) << 16)
+                            | (static_cast<uint32_t> (m_candidates.mode[c].GetMcsValue ()) << 8)
+                            | static_cast<uint32_t> (barType.m_variant));
+      m_dlAckKey.push_back ((static_cast<uint32_t> (baType.m_variant) << 24)
+                            | (static_cast<uint32_t> (baType.m_bitmapLen.size ()) << 16)
+                            | (baType.m_bitmapLen.empty () ? 0 : baType.m_bitmapLen[0]));
+
+      if (dlMuAckSequence == DlMuAckSequenceType::DL_SU_FORMAT)
+        {
+          // Enable BAR/BA exchange for all the receiver stations
+          m_txParams.EnableBlockAckRequest (address, barType, baType);
+        }
+      else if (dlMuAckSequence == DlMuAckSequenceType::DL_MU_BAR)
+        {
+          // Send a MU-BAR to all the stations
+          m_txParams.EnableBlockAckRequest (address, barType, baType);
+        }
+      else if (dlMuAckSequence == DlMuAckSequenceType::DL_AGGREGATE_TF)
+        {
+          // Expect to receive a Block Ack from all the stations
+          m_txParams.EnableBlockAck (address, baType);
+        }
+    }
+}
+
+AckOverheadCache::Entry&
+RrOfdmaManager::LookupDlAckOverhead (void)
+{
+  NS_ASSERT (m_dlAckKey.size () >= RR_OFDMA_ACK_KEY_HEADER);
+  // the MU-BAR is sent with the TX vector used for broadcast control frames
+  WifiTxVector barTxVector = GetWifiRemoteStationManager ()->GetRtsTxVector (m_triggerHdr.GetAddr1 (),
+                                                                             &m_triggerHdr, m_triggerPayload);
+  m_dlAckKey[0] = (static_cast<uint32_t> (m_txParams.GetDlMuAckSequenceType ()) << 16)
+                  | m_txVector.GetChannelWidth ();
+  m_dlAckKey[1] = (static_cast<uint32_t> (m_low->GetPhy ()->GetFrequency ()) << 16)
+                  | m_txVector.GetGuardInterval ();
+  m_dlAckKey[2] = barTxVector.GetMode ().GetUid ();
+  return m_dlAckOverhead.Lookup (m_dlAckKey);
+}
+
+uint16_t
+RrOfdmaManager::GetDlAckUlLength (AckOverheadCache::Entry& entry, const CtrlTriggerHeader& trigger)
+{
+  if (!entry.ulLengthValid)
+    {
+      entry.ulLength = m_low->CalculateUlLengthForBlockAcks (trigger, m_txParams);
+      entry.ulLengthValid = true;
+    }
+  return entry.ulLength;
+}
+
+Time
+RrOfdmaManager::GetDlResponseDuration (void)
+{
+  if (m_txParams.GetDlMuAckSequenceType () != DlMuAckSequenceType::DL_MU_BAR
+      && m_txParams.GetDlMuAckSequenceType () != DlMuAckSequenceType::DL_AGGREGATE_TF)
+    {
+      // BARs and Block Acks are sent in SU PPDUs, whose TX vector depends on
+      // the state of the remote station manager, hence the response is not cached
+      return GetResponseDuration (m_txParams, m_txVector, CtrlTriggerHeader ());
+    }
+
+  AckOverheadCache::Entry& entry = LookupDlAckOverhead ();
+  if (!entry.responseValid)
+    {
+      // Need to prepare the MU-BAR to correctly get the response time
+      CtrlTriggerHeader trigger = GetTriggerFrameHeader (m_txVector, 5);
+      trigger.SetUlLength (GetDlAckUlLength (entry, trigger));
+      entry.response = GetResponseDuration (m_txParams, m_txVector, trigger);
+      entry.responseValid = true;
+    }
+  return entry.response;
+}
+
+OfdmaTxFormat
+RrOfdmaManager::SelectTxFormat (Ptr<const WifiMacQueueItem> mpdu)
+{
+  NS_LOG_FUNCTION (this << *mpdu);
+  NS_ASSERT (mpdu->GetHeader ().IsQosData ());
+  AllocationScope allocationScope (m_nDecisionAllocations);
+  m_nDecisions++;
+
+  if (!m_backlogTracesConnected)
+    {
+      ConnectBacklogTraces ();
+    }
+  if (m_raRuPending)
+    {
+      CompleteRaRus ();
+    }
+  if (m_ulPending)
+    {
+      CompleteUlExchange ();
+    }
+
+  bool tryUl = m_enableUlOfdma
+               && (m_txFormatSelection == FORMAT_ADAPTIVE ? IsUlPreferred () : GetTxFormat () == DL_OFDMA);
+  if (tryUl)
+    {
+      // check if an UL OFDMA transmission is possible
+      NS_ABORT_MSG_IF (m_ulPsduSize == 0, "The UlPsduSize attribute must be set to a non-null value");
+
+      Ptr<QosTxop> txop = m_qosTxop[QosUtilsMapTidToAc (mpdu->GetHeader ().GetQosTid ())];
+      m_ulMuAckSequence = txop->GetAckPolicySelector ()->GetAckSequenceForUlMu ();
+      if (m_ulMuAckSequence != UL_MULTI_STA_BLOCK_ACK)
+        {
+          NS_FATAL_ERROR ("Sending Block Acks in an MU DL PPDU is not supported yet");
+        }
+
+      // the receivers of the last DL MU PPDU are solicited, unless they reported
+      // that their buffers are empty
+      m_ulStations.clear ();
+      std::size_t nContenders = 0;
+      const std::map<uint16_t, Mac48Address>& staList = m_apMac->GetStaList ();
+      for (auto& userInfo : m_txVector.GetHeMuUserInfoMap ())
+        {
+          auto addressIt = staList.find (userInfo.first);
+          if (addressIt == staList.end ())
+            {
+              NS_LOG_WARN ("Maybe station with AID=" << userInfo.first << " left the BSS since the last MU DL transmission?");
+              continue;
+            }
+          if (m_nRaRus > 0 && m_apMac->GetMaxBufferStatus (addressIt->second) == 255)
+            {
+              NS_LOG_DEBUG ("Buffer status of station " << addressIt->second << " is unknown, it contends for RA-RUs");
+              nContenders++;
+              continue;
+            }
+          uint32_t bufferSize = GetUlBufferSize (userInfo.first, addressIt->second);
+          if (bufferSize > 0)
+            {
+              m_ulStations.push_back ({userInfo.first, addressIt->second, bufferSize,
+                                       userInfo.second.mcs, userInfo.second.nss,
+                                       {false, HeRu::RU_26_TONE, 1}});
+            }
+        }
+
+      // if no station has frames to send, skip UL OFDMA and proceed with trying DL OFDMA
+      std::size_t nRaRus = (nContenders > 0 ? m_nRaRus : 0);
+      if (!m_ulStations.empty () || nRaRus > 0)
+        {
+          // size the RU of each station based on its buffer status and MCS
+          AllocateUlRus (m_low->GetPhy ()->GetChannelWidth (), nRaRus);
+
+          MacLowTransmissionParameters params;
+          params.SetUlMuAckSequenceType (m_ulMuAckSequence);
+          BlockAckType baType = BlockAckType::MULTI_STA;
+          for (auto& station : m_ulStations)
+            {
+              baType.m_bitmapLen.push_back (32);
+              params.EnableBlockAck (station.address, baType);
+            }
+
+          CtrlTriggerHeader trigger (TriggerFrameType::BASIC_TRIGGER, m_ulTxVector);
+          AddRaRuUserInfoFields (trigger);
+
+          // compute the maximum amount of time that can be granted to stations.
+          // This value is limited by the max PPDU duration
+          Time maxDuration = GetPpduMaxTime (m_ulTxVector.GetPreambleType ());
+
+          // if we are within a TXOP, we have to consider the response time and the
+          // remaining TXOP duration
+          if (txop->GetTxopLimit ().IsStrictlyPositive ())
+            {
+              Time response = GetUlExchangeOverhead (trigger, params);
+
+              if (response > txop->GetTxopRemaining ())
+                {
+                  // an UL OFDMA transmission is not possible. Reset the candidates and return DL_OFDMA.
+                  // In this way, no transmission will occur now and the next time we will try again
+                  // performing an UL OFDMA transmission.
+                  NS_LOG_DEBUG ("Remaining TXOP duration is not enough for UL MU exchange");
+                  m_candidates.Clear ();
+                  m_ranking.clear ();
+                  return DL_OFDMA;
+                }
+
+              maxDuration = Min (maxDuration, txop->GetTxopRemaining () - response);
+            }
+
+          // compute the time required by each station to transmit its buffered
+          // frames in its RU. The HE TB PPDU lasts as long as required by the
+          // station needing the longest time (the bottleneck station)
+          Time bufferTxTime = Seconds (0);
+          uint16_t bottleneck = 0;
+          for (auto& station : m_ulStations)
+            {
+              Time txTime = (station.bufferSize == 0xffffffff
+                             ? maxDuration
+                             : GetUlTxDuration (station.bufferSize, station.aid));
+              if (txTime > bufferTxTime)
+                {
+                  bufferTxTime = txTime;
+                  bottleneck = station.aid;
+                }
+            }
+          if (!m_raRus.empty ())
+            {
+              // stations contending for the RA-RUs are expected to have UlPsduSize bytes
+              Time txTime = GetUlTxDuration (m_ulPsduSize, 0);
+              if (txTime > bufferTxTime)
+                {
+                  bufferTxTime = txTime;
+                  bottleneck = 0;
+                }
+            }
+          if (bufferTxTime < maxDuration)
+            {
+              // the buffered frames can be transmitted within the allowed time
+              maxDuration = bufferTxTime;
+            }
+          else
+            {
+              // maxDuration may be a too short time. If it does not allow to transmit
+              // at least m_ulPsduSize bytes, give up the UL MU transmission for now
+              Time minDuration = GetUlTxDuration (m_ulPsduSize, bottleneck);
+              if (maxDuration < minDuration)
+                {
+                  // maxDuration is a too short time. Reset the candidates and return DL_OFDMA.
+                  // In this way, no transmission will occur now and the next time we will try again
+                  // performing an UL OFDMA transmission.
+                  NS_LOG_DEBUG ("Available time " << maxDuration << " is too short");
+                  m_candidates.Clear ();
+                  m_ranking.clear ();
+                  return DL_OFDMA;
+                }
+            }
+
+          // maxDuration is the time to grant to the stations. Store it in the TX vector
+          NS_LOG_DEBUG ("HE TB PPDU duration: " << maxDuration.ToDouble (Time::MS));
+          uint16_t length = WifiPhy::ConvertHeTbPpduDurationToLSigLength (maxDuration,
+                                                                          m_low->GetPhy ()->GetFrequency ());
+          m_ulTxVector.SetLength (length);
+          m_txParams = params;
+          m_ulServedShare += RR_OFDMA_UL_SHARE_WEIGHT * (1 - m_ulServedShare);
+          return UL_OFDMA;
+        }
+    }
+  m_ulServedShare -= RR_OFDMA_UL_SHARE_WEIGHT * m_ulServedShare;
+
+  // a DL MU PPDU addressed to a single station is less efficient than an SU PPDU
+  if (m_singleStationSu && !m_forceDlOfdma
+      && m_ringNext[0] != 0 && m_ringNext[m_ringNext[0]] == 0)
+    {
+      NS_LOG_DEBUG ("The AP has frames to send to a single station: return NON_OFDMA");
+      return OfdmaTxFormat::NON_OFDMA;
+    }
+
+  if (m_lookaheadValid)
+    {
+      m_lookaheadValid = false;
+      SetLookaheadMembers (false);
+      if (IsLookaheadValid (mpdu))
+        {
+          NS_LOG_DEBUG ("Commit the DL MU PPDU planned in advance");
+          SwapDlState (m_lookaheadState);
+          if (m_dlTxopRemaining.IsStrictlyPositive ())
+            {
+              // the TXOP plan refers to the TXOP that has just started
+              m_txopPlanStart = Simulator::Now ();
+            }
+          m_nLookaheadHits++;
+          return m_lookaheadFormat;
+        }
+      NS_LOG_DEBUG ("The DL MU PPDU planned in advance is no longer valid");
+      m_nLookaheadMisses++;
+    }
+
+  return SelectDlTxFormat (mpdu, false);
+}
+
+OfdmaTxFormat
+RrOfdmaManager::SelectDlTxFormat (Ptr<const WifiMacQueueItem> mpdu, bool newTxop)
+{
+  NS_LOG_FUNCTION (this << *mpdu << newTxop);
+
+  // get the list of associated stations ((AID, MAC address) pairs)
+  const std::map<uint16_t, Mac48Address>& staList = m_apMac->GetStaList ();
+  auto startIt = staList.lower_bound (m_startStation);
+
+  // This may be the first invocation or the stations following the starting one left
+  if (startIt == staList.end ())
+    {
+      startIt = staList.begin ();
+    }
+
+  uint8_t currTid = mpdu->GetHeader ().GetQosTid ();
+  AcIndex primaryAc = QosUtilsMapTidToAc (currTid);
+  m_candidates.Clear ();
+  m_ranking.clear ();
+  m_dlPlan.newTxopPlan = false;
+
+  // Our best guess at this stage is that the AP has frames to send to all the
+  // associated stations, hence the RUs are computed assuming that the maximum
+  // number of stations is served
+  std::size_t count = m_nStations;
+  const std::vector<HeRu::RuSpec>& guessRus = GetNumberAndTypeOfRus (m_low->GetPhy ()->GetChannelWidth (), count);
+  NS_ASSERT (count >= 1);
+
+  Ptr<WifiAckPolicySelector> ackSelector = m_qosTxop[primaryAc]->GetAckPolicySelector ();
+  NS_ASSERT (ackSelector != 0);
+  m_dlMuAckSequence = ackSelector->GetAckSequenceForDlMu ();
+
+  // if the AC owns a TXOP, compute the time available for the transmission of data frames
+  Time txopLimit = Seconds (0);
+  Time response = Seconds (0);
+  m_dlTxopRemaining = Seconds (0);
+  if (m_qosTxop[primaryAc]->GetTxopLimit ().IsStrictlyPositive ())
+    {
+      // If the primary AC holds a TXOP, we can select a station as a receiver of
+      // the MU PPDU only if the AP has frames to send to such station that fit into
+      // the remaining TXOP time. To this end, we need to determine the type of ack
+      // sequence and the time it takes. To compute the latter, we can call the
+      // MacLow::GetResponseDuration () method, which requires TX vector and TX params.
+      // We initialize the TX vector and the TX params by considering the starting
+      // station and those that immediately follow it in the list of associated stations.
+      // The guessed stations are temporarily stored as candidates.
+      auto staIt = startIt;
+      do
+        {
+          AddCandidate (staIt->second, staIt->first, currTid, 0, GetSuTxInfo (staIt->first, staIt->second, 0));
+          if (++staIt == staList.end ())
+            {
+              staIt = staList.begin ();
+            }
+        } while (m_ranking.size () < count && staIt != startIt);
+      InitTxVectorAndParams (guessRus, m_dlMuAckSequence);
+
+      // TODO Account for MU-RTS/CTS when implemented
+      response = GetDlResponseDuration ();
+      if (m_dlAckSequenceSelection == ACK_SEQ_COST_MODEL)
+        {
+          // the ack sequence is selected once the receivers are known, hence
+          // candidates are checked against the shortest response
+          for (DlMuAckSequenceType dlMuAckSequence : RR_OFDMA_DL_ACK_SEQUENCES)
+            {
+              if (dlMuAckSequence != m_dlMuAckSequence)
+                {
+                  InitTxVectorAndParams (guessRus, dlMuAckSequence);
+                  response = Min (response, GetDlResponseDuration ());
+                }
+            }
+        }
+      m_candidates.Clear ();
+      m_ranking.clear ();
+
+      m_dlTxopRemaining = (newTxop ? m_qosTxop[primaryAc]->GetTxopLimit ()
+                                   : m_qosTxop[primaryAc]->GetTxopRemaining ());
+      txopLimit = m_dlTxopRemaining - response;
+
+      if (txopLimit.IsNegative ())
+        {
+          if (m_forceDlOfdma)
+            {
+              NS_LOG_DEBUG ("Not enough TXOP remaining time: return DL_OFDMA with empty set of receiver stations");
+              return OfdmaTxFormat::DL_OFDMA;
+            }
+          NS_LOG_DEBUG ("Not enough TXOP remaining time: return NON_OFDMA");
+          return OfdmaTxFormat::NON_OFDMA;
+        }
+    }
+  m_maxDlDuration = (txopLimit.IsStrictlyPositive () ? txopLimit : MicroSeconds (RR_OFDMA_PPDU_MAX_TIME_US));
+
+  // bitmap of the TIDs mapped to the primary AC or higher
+  uint8_t eligibleTids = 0;
+  for (uint8_t tid = 0; tid < 8; tid++)
+    {
+      if (QosUtilsMapTidToAc (tid) >= primaryAc)
+        {
+          eligibleTids |= (1 << tid);
+        }
+    }
+
+  Time maxDlDuration = m_maxDlDuration;
+  bool useSlot = false;
+  if (m_txopPlanning && m_dlTxopRemaining.IsStrictlyPositive ())
+    {
+      // lay out the DL MU PPDUs of the TXOP when the TXOP is won or when the
+      // planned PPDUs have all been sent
+      Time txopStart = Simulator::Now () - (m_qosTxop[primaryAc]->GetTxopLimit () - m_dlTxopRemaining);
+      if (txopStart != m_txopPlanStart || m_nextTxopSlot >= m_txopSlots.size ())
+        {
+          m_txopPlanStart = txopStart;
+          PlanTxop (eligibleTids, guessRus, response + m_low->GetPhy ()->GetSifs ());
+          m_dlPlan.newTxopPlan = true;
+        }
+      useSlot = (m_nextTxopSlot < m_txopSlots.size ());
+      if (useSlot)
+        {
+          SetTxopSlotMembers (true);
+          m_maxDlDuration = Min (m_maxDlDuration, m_txopSlots[m_nextTxopSlot].duration);
+        }
+    }
+
+  uint16_t aid = AddDlCandidates (currTid, primaryAc, eligibleTids, guessRus, txopLimit, useSlot);
+  if (useSlot)
+    {
+      SetTxopSlotMembers (false);
+      if (m_ranking.empty ())
+        {
+          NS_LOG_DEBUG ("No frames to send to the stations of the planned PPDU, drop the TXOP plan");
+          m_txopSlots.clear ();
+          m_nextTxopSlot = 0;
+          useSlot = false;
+          m_maxDlDuration = maxDlDuration;
+          aid = AddDlCandidates (currTid, primaryAc, eligibleTids, guessRus, txopLimit, false);
+        }
+    }
+
+  if (m_ranking.empty ())
+    {
+      if (m_forceDlOfdma)
+        {
+          NS_LOG_DEBUG ("The AP does not have suitable frames to transmit: return DL_OFDMA with empty set of receiver stations");
+          return OfdmaTxFormat::DL_OFDMA;
+        }
+      NS_LOG_DEBUG ("The AP does not have suitable frames to transmit: return NON_OFDMA");
+      return OfdmaTxFormat::NON_OFDMA;
+    }
+
+  if (useSlot)
+    {
+      // the stations of the TXOP plan are not necessarily consecutive, hence
+      // the round robin order resumes after the plan is completed
+      if (++m_nextTxopSlot == m_txopSlots.size () && m_txopPlanNextStart != 0)
+        {
+          m_startStation = m_txopPlanNextStart;
+        }
+    }
+  else if (aid != 0)
+    {
+      m_startStation = aid;
+    }
+  BuildDlSchedulingPlan (useSlot);
+  return OfdmaTxFormat::DL_OFDMA;
+}
+
+bool
+RrOfdmaManager::IsLookaheadValid (Ptr<const WifiMacQueueItem> mpdu) const
+{
+  if (m_lookaheadVersion != m_dlStateVersion || m_lookaheadSuTxInfoEpoch != m_suTxInfoEpoch
+      || m_lookaheadTid != mpdu->GetHeader ().GetQosTid ())
+    {
+      return false;
+    }
+  // the plan assumes that the TXOP (if any) has just started
+  Ptr<QosTxop> txop = m_qosTxop[QosUtilsMapTidToAc (m_lookaheadTid)];
+  return (!txop->GetTxopLimit ().IsStrictlyPositive () || txop->GetTxopRemaining () == txop->GetTxopLimit ());
+}
+
+void
+RrOfdmaManager::Lookahead (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_mpdu == 0 || !m_mpdu->GetHeader ().IsQosData ())
+    {
+      return;
+    }
+
+  AllocationScope allocationScope (m_nDecisionAllocations);
+  SetLookaheadMembers (false);
+
+  // the plan is computed in the storage of m_lookaheadState, which is swapped
+  // with the current state, starting from the inputs of the current state.
+  // The current state is then swapped back
+  SwapDlState (m_lookaheadState);
+  LoadDlInputs (m_lookaheadState);
+  m_lookaheadTid = m_mpdu->GetHeader ().GetQosTid ();
+  m_lookaheadSuTxInfoEpoch = m_suTxInfoEpoch;
+  m_lookaheadFormat = SelectDlTxFormat (m_mpdu, true);
+  SwapDlState (m_lookaheadState);
+  SetLookaheadMembers (true);
+  // changes notified from now on invalidate the plan
+  m_lookaheadVersion = m_dlStateVersion;
+  m_lookaheadValid = true;
+}
+
+void
+RrOfdmaManager::SetLookaheadMembers (bool member)
+{
+  const std::vector<uint16_t>& aids = m_lookaheadState.candidates.aid;
+  for (std::size_t i = 0; i < aids.size (); i++)
+    {
+      m_lookaheadMember[aids[i]] = (member ? 1 : 0);
+    }
+}
+
+void
+RrOfdmaManager::LoadDlInputs (const DlState& state)
+{
+  m_startStation = state.startStation;
+  m_txopPlanStart = state.txopPlanStart;
+  m_txopPlanAids.assign (state.txopPlanAids.begin (), state.txopPlanAids.end ());
+  m_txopPlanDemand.assign (state.txopPlanDemand.begin (), state.txopPlanDemand.end ());
+  m_txopSlots.assign (state.txopSlots.begin (), state.txopSlots.end ());
+  m_nextTxopSlot = state.nextTxopSlot;
+  m_txopPlanNextStart = state.txopPlanNextStart;
+}
+
+void
+RrOfdmaManager::SwapDlState (DlState& state)
+{
+  std::swap (m_candidates, state.candidates);
+  m_ranking.swap (state.ranking);
+  std::swap (m_dlPlan, state.dlPlan);
+  std::swap (m_txVector, state.txVector);
+  std::swap (m_txParams, state.txParams);
+  std::swap (m_dlMuAckSequence, state.dlMuAckSequence);
+  std::swap (m_maxDlDuration, state.maxDlDuration);
+  std::swap (m_dlTxopRemaining, state.dlTxopRemaining);
+  std::swap (m_startStation, state.startStation);
+  std::swap (m_txopPlanStart, state.txopPlanStart);
+  m_txopPlanAids.swap (state.txopPlanAids);
+  m_txopPlanDemand.swap (state.txopPlanDemand);
+  m_txopSlots.swap (state.txopSlots);
+  std::swap (m_nextTxopSlot, state.nextTxopSlot);
+  std::swap (m_txopPlanNextStart, state.txopPlanNextStart);
+}
+
+uint16_t
+RrOfdmaManager::AddDlCandidates (uint8_t currTid, AcIndex primaryAc, uint8_t eligibleTids,
+                                 const std::vector<HeRu::RuSpec>& guessRus, Time txopLimit, bool useSlot)
+{
+  NS_LOG_FUNCTION (this << +currTid << primaryAc << +eligibleTids << txopLimit << useSlot);
+
+  if (m_schedulingPolicy != SCHED_RR)
+    {
+      return AddDlCandidatesByMetric (currTid, primaryAc, eligibleTids, guessRus, txopLimit, useSlot);
+    }
+
+  // iterate over the backlogged stations, in increasing order of AID starting from
+  // the station to start with, until an enough number of stations is identified
+  uint16_t aid = FindActiveStation (m_startStation);
+  uint16_t firstAid = aid;
+  bool wrapped = false;
+  while (aid != 0)
+    {
+      // check if the AP has at least one frame to be sent to the current station
+      uint8_t backlog = m_backlog[aid] & eligibleTids;
+      if (useSlot && !m_txopSlotMember[aid])
+        {
+          // the station is served by another PPDU of the TXOP
+          backlog = 0;
+        }
+      // the RU the station would be assigned if it were selected
+      const HeRu::RuSpec& ru = guessRus[std::min (m_ranking.size (), guessRus.size () - 1)];
+      AddDlCandidate (aid, backlog, currTid, ru, txopLimit);
+
+      // move to the next backlogged station. Stations may become idle while
+      // their queues are peeked, hence the next station is looked up afresh
+      uint16_t next = GetNextActiveStation (aid);
+      wrapped = wrapped || next <= aid;
+      aid = next;
+      if (m_ranking.size () >= m_nStations || (wrapped && aid >= firstAid))
+        {
+          break;
+        }
+    }
+
+  CheckScratchCapacity ();
+  return aid;
+}
+
+uint16_t
+RrOfdmaManager::AddDlCandidatesByMetric (uint8_t currTid, AcIndex primaryAc, uint8_t eligibleTids,
+                                         const std::vector<HeRu::RuSpec>& guessRus, Time txopLimit,
+                                         bool useSlot)
+{
+  NS_LOG_FUNCTION (this << +currTid << primaryAc << +eligibleTids << txopLimit << useSlot);
+
+  // stations are compared by decreasing metric; ties are broken in favor of
+  // the stations that come first in the round robin order
+  auto better = [] (const StationMetric& a, const StationMetric& b)
+    {
+      return (a.metric > b.metric || (a.metric == b.metric && a.order < b.order));
+    };
+
+  // walk the ring of backlogged stations once and keep the stations with the
+  // highest metric in a heap bounded to the maximum number of stations, whose
+  // top is the worst of them. The metric only depends on per-AID state and,
+  // with earliest deadline first scheduling, on the head of the queues, hence
+  // the frames are only checked against the size and time limits afterwards
+  m_topStations.clear ();
+  std::size_t maxStations = std::min<std::size_t> (m_nStations, m_topStations.capacity ());
+  uint16_t order = 0;
+  uint16_t aid = FindActiveStation (m_startStation);
+  uint16_t firstAid = aid;
+  bool wrapped = false;
+  while (aid != 0)
+    {
+      // only the TIDs with a BA agreement can be served in a DL MU PPDU
+      uint8_t backlog = m_backlog[aid] & eligibleTids & m_baTids[aid];
+      StationMetric station = {0.0, order++, aid};
+      if (backlog != 0 && (!useSlot || m_txopSlotMember[aid])
+          && GetStationMetric (aid, backlog, currTid, station.metric))
+        {
+          if (m_topStations.size () < maxStations)
+            {
+              m_topStations.push_back (station);
+              std::push_heap (m_topStations.begin (), m_topStations.end (), better);
+            }
+          else if (better (station, m_topStations.front ()))
+            {
+              std::pop_heap (m_topStations.begin (), m_topStations.end (), better);
+              m_topStations.back () = station;
+              std::push_heap (m_topStations.begin (), m_topStations.end (), better);
+            }
+        }
+
+      uint16_t next = GetNextActiveStation (aid);
+      wrapped = wrapped || next <= aid;
+      aid = next;
+      if (wrapped && aid >= firstAid)
+        {
+          break;
+        }
+    }
+
+  // only the selected stations, best first, have their queues peeked and
+  // their head-of-line frame checked against the size and time limits
+  std::sort_heap (m_topStations.begin (), m_topStations.end (), better);
+  for (const StationMetric& station : m_topStations)
+    {
+      const HeRu::RuSpec& ru = guessRus[std::min (m_ranking.size (), guessRus.size () - 1)];
+      if (AddDlCandidate (station.aid, m_backlog[station.aid] & eligibleTids, currTid, ru, txopLimit) != 0)
+        {
+          m_candidates.metric[m_ranking.back ()] = station.metric;
+        }
+    }
+
+  CheckScratchCapacity ();
+  return aid;
+}
+
+bool
+RrOfdmaManager::GetStationMetric (uint16_t aid, uint8_t backlog, uint8_t currTid, double& metric)
+{
+  if (m_schedulingPolicy == SCHED_PF)
+    {
+      // instantaneous rate (in the smallest RU) over average throughput
+      const SuTxInfo& suTxInfo = GetSuTxInfo (aid, m_staAddress[aid], 0);
+      uint64_t rate = suTxInfo.mode.GetDataRate (HeRu::GetBandwidth (HeRu::RU_26_TONE),
+                                                 m_low->GetPhy ()->GetGuardInterval ().GetNanoSeconds (),
+                                                 suTxInfo.nss);
+      metric = rate / std::max (GetAverageThroughput (aid), 1.0);
+      return true;
+    }
+
+  NS_ASSERT (m_schedulingPolicy == SCHED_EDF);
+  // the deadline is set by the head-of-line frame of the TID that would be
+  // served, which expires when its lifetime exceeds the queue MaxDelay
+  for (uint8_t tid : std::initializer_list<uint8_t> {currTid, 1, 2, 0, 3, 4, 5, 6, 7})
+    {
+      if ((backlog & (1 << tid)) == 0)
+        {
+          continue;
+        }
+      AcIndex ac = QosUtilsMapTidToAc (tid);
+      Ptr<const WifiMacQueueItem> mpdu = m_qosTxop[ac]->PeekNextFrame (tid, m_staAddress[aid]);
+      if (mpdu != 0)
+        {
+          m_holDeadline[aid] = mpdu->GetTimeStamp () + m_qosTxop[ac]->GetWifiMacQueue ()->GetMaxDelay ();
+          metric = -m_holDeadline[aid].GetSeconds ();
+          return true;
+        }
+    }
+  return false;
+}
+
+Ptr<const WifiMacQueueItem>
+RrOfdmaManager::AddDlCandidate (uint16_t aid, uint8_t backlog, uint8_t currTid, const HeRu::RuSpec& ru,
+                                Time txopLimit)
+{
+  Mac48Address address = m_staAddress[aid];
+  NS_LOG_DEBUG ("Next candidate STA (MAC=" << address << ", AID=" << aid << ")");
+  for (uint8_t tid : std::initializer_list<uint8_t> {currTid, 1, 2, 0, 3, 4, 5, 6, 7})
+    {
+      if (backlog == 0)
+        {
+          NS_LOG_DEBUG ("No frames to send to " << address);
+          break;
+        }
+      if ((backlog & (1 << tid)) == 0)
+        {
+          // no frame queued for this TID
+          continue;
+        }
+      // check that a BA agreement is established with the receiver for the
+      // considered TID, since ack sequences for DL MU PPDUs require block ack
+      if (m_baTids[aid] & (1 << tid))
+        {
+          AcIndex ac = QosUtilsMapTidToAc (tid);
+          Ptr<const WifiMacQueueItem> mpdu;
+          mpdu = m_qosTxop[ac]->PeekNextFrame (tid, address);
+
+          // we only check if the first frame of the current TID meets the size
+          // and duration constraints. We do not explore the queues further.
+          if (mpdu != 0)
+            {
+              // Use a temporary TX vector including only the STA-ID of the
+              // candidate station to check if the MPDU meets the size and time limits.
+              // An RU of the computed size is tentatively assigned to the candidate
+              // station, so that the TX duration can be correctly computed.
+              const SuTxInfo& suTxInfo = GetSuTxInfo (aid, address, mpdu);
+              WifiTxVector muTxVector;
+
+              muTxVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
+              muTxVector.SetChannelWidth (m_low->GetPhy ()->GetChannelWidth ());
+              muTxVector.SetGuardInterval (m_low->GetPhy ()->GetGuardInterval ().GetNanoSeconds ());
+              muTxVector.SetHeMuUserInfo (aid, {{false, ru.ruType, 1}, suTxInfo.mode, suTxInfo.nss});
+
+              if (IsWithinSizeAndTimeLimits (mpdu, muTxVector, aid, txopLimit))
+                {
+                  // the frame meets the constraints, add the station to the list
+                  NS_LOG_DEBUG ("Adding candidate STA (MAC=" << address << ", AID="
+                                << aid << ") TID=" << +tid);
+                  AddCandidate (address, aid, tid, mpdu->GetPacket ()->GetSize (), suTxInfo);
+                  return mpdu;
+                }
+            }
+          else
+            {
+              NS_LOG_DEBUG ("No frames to send to " << address << " with TID=" << +tid);
+            }
+        }
+    }
+  return 0;
+}
+
+void
+RrOfdmaManager::PlanTxop (uint8_t eligibleTids, const std::vector<HeRu::RuSpec>& guessRus, Time overhead)
+{
+  NS_LOG_FUNCTION (this << +eligibleTids << overhead);
+  NS_ASSERT (!guessRus.empty ());
+
+  Ptr<WifiPhy> phy = m_low->GetPhy ();
+  m_txDurationCache.SetPhyParameters (phy->GetChannelWidth (), phy->GetGuardInterval ().GetNanoSeconds (),
+                                      phy->GetFrequency ());
+  const HeRu::RuSpec& ru = guessRus.front ();
+  Time ppduMaxTime = MicroSeconds (RR_OFDMA_PPDU_MAX_TIME_US);
+
+  // compute the time needed by each backlogged station, in round robin order
+  m_txopPlanEntries.clear ();
+  uint16_t order = 0;
+  uint16_t aid = FindActiveStation (m_startStation);
+  uint16_t firstAid = aid;
+  bool wrapped = false;
+  while (aid != 0)
+    {
+      uint8_t tids = m_backlog[aid] & eligibleTids & m_baTids[aid];
+      uint64_t bytes = 0;
+      for (uint8_t tid = 0; tid < 8; tid++)
+        {
+          if (tids & (1 << tid))
+            {
+              bytes += m_nQueuedBytes[aid * 8 + tid];
+            }
+        }
+
+      if (bytes > 0)
+        {
+          // time needed to send the queued frames in an RU of the guessed size
+          const SuTxInfo& suTxInfo = GetSuTxInfo (aid, m_staAddress[aid], 0);
+          uint64_t rate = suTxInfo.mode.GetDataRate (HeRu::GetBandwidth (ru.ruType),
+                                                     phy->GetGuardInterval ().GetNanoSeconds (),
+                                                     suTxInfo.nss);
+          uint64_t maxBytes = static_cast<uint64_t> (rate * ppduMaxTime.GetSeconds () / 8);
+          WifiTxVector muTxVector;
+          muTxVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
+          muTxVector.SetChannelWidth (phy->GetChannelWidth ());
+          muTxVector.SetGuardInterval (phy->GetGuardInterval ().GetNanoSeconds ());
+          muTxVector.SetHeMuUserInfo (aid, {ru, suTxInfo.mode, suTxInfo.nss});
+          Time demand = Min (ppduMaxTime, m_txDurationCache.GetTxDuration (std::min (bytes, maxBytes),
+                                                                           muTxVector, aid));
+          m_txopPlanEntries.push_back ({demand, order++, aid});
+        }
+
+      uint16_t next = GetNextActiveStation (aid);
+      wrapped = wrapped || next <= aid;
+      aid = next;
+      if (wrapped && aid >= firstAid)
+        {
+          break;
+        }
+    }
+
+  BuildTxopPlan (guessRus.size (), overhead, aid);
+}
+
+void
+RrOfdmaManager::BuildTxopPlan (std::size_t groupSize, Time overhead, uint16_t nextAid)
+{
+  NS_LOG_FUNCTION (this << groupSize << overhead << nextAid);
+  NS_ASSERT (groupSize > 0);
+
+  m_txopPlanAids.clear ();
+  m_txopPlanDemand.clear ();
+  m_txopSlots.clear ();
+  m_nextTxopSlot = 0;
+
+  // sort the stations by decreasing demand, so that the stations served by
+  // the same PPDU need similar times and little padding is added to their
+  // A-MPDUs. Ties are broken in round robin order
+  std::sort (m_txopPlanEntries.begin (), m_txopPlanEntries.end (),
+             [] (const TxopPlanEntry& a, const TxopPlanEntry& b)
+             {
+               return (a.demand > b.demand || (a.demand == b.demand && a.order < b.order));
+             });
+
+  // each PPDU serves groupSize stations and lasts as long as required by the
+  // first station of the group, i.e., the one with the largest demand. Hence,
+  // a station joining a PPDU that is not full does not need more time, while
+  // a station starting a new PPDU is skipped (and left for the next TXOP) if
+  // the PPDU and its acknowledgment do not fit in the remaining TXOP. The
+  // following stations are still considered, as they may need less time. The
+  // first PPDU is always planned and shortened if needed
+  Time total = Seconds (0);
+  const TxopPlanEntry* firstSkipped = 0;
+  for (const TxopPlanEntry& entry : m_txopPlanEntries)
+    {
+      std::size_t n = m_txopPlanAids.size ();
+      if (n % groupSize == 0 && n > 0 && total + entry.demand + overhead > m_dlTxopRemaining)
+        {
+          if (firstSkipped == 0 || entry.order < firstSkipped->order)
+            {
+              firstSkipped = &entry;
+            }
+          continue;
+        }
+      if (n % groupSize == 0)
+        {
+          total += entry.demand + overhead;
+        }
+      m_txopPlanAids.push_back (entry.aid);
+      m_txopPlanDemand.push_back (entry.demand);
+    }
+  // the next TXOP starts from the first station (in round robin order) left
+  // out of this one
+  m_txopPlanNextStart = (firstSkipped != 0 ? firstSkipped->aid : nextAid);
+
+  // the last PPDU is shortened to fit in the remaining TXOP
+  Time elapsed = Seconds (0);
+  for (std::size_t i = 0; i < m_txopPlanAids.size (); i += groupSize)
+    {
+      Time duration = Min (m_txopPlanDemand[i], m_dlTxopRemaining - elapsed - overhead);
+      if (!duration.IsStrictlyPositive ())
+        {
+          break;
+        }
+      m_txopSlots.push_back ({i, std::min (groupSize, m_txopPlanAids.size () - i), duration});
+      elapsed += duration + overhead;
+    }
+  NS_LOG_DEBUG ("Planned " << m_txopSlots.size () << " DL MU PPDUs serving " << m_txopPlanAids.size ()
+                << " stations in " << elapsed.As (Time::US) << " out of " << m_dlTxopRemaining.As (Time::US));
+}
+
+void
+RrOfdmaManager::SetTxopSlotMembers (bool member)
+{
+  NS_ASSERT (m_nextTxopSlot < m_txopSlots.size ());
+  const TxopSlot& slot = m_txopSlots[m_nextTxopSlot];
+  for (std::size_t i = slot.first; i < slot.first + slot.nStations; i++)
+    {
+      m_txopSlotMember[m_txopPlanAids[i]] = (member ? 1 : 0);
+    }
+}
+
+bool
+RrOfdmaManager::IsWithinSizeAndTimeLimits (Ptr<const WifiMacQueueItem> mpdu, const WifiTxVector& muTxVector,
+                                           uint16_t staId, Time ppduDurationLimit)
+{
+  NS_LOG_FUNCTION (this << *mpdu << staId << ppduDurationLimit);
+
+  // Same checks as MacLow::IsWithinSizeAndTimeLimits, except that the TX
+  // duration is taken from the cache
+  const WifiMacHeader& hdr = mpdu->GetHeader ();
+  WifiModulationClass modulation = muTxVector.GetMode (staId).GetModulationClass ();
+  uint32_t maxAmpduSize = 0;
+  if (m_low->GetMpduAggregator () != 0)
+    {
+      maxAmpduSize = m_low->GetMpduAggregator ()->GetMaxAmpduSize (hdr.GetAddr1 (),
+                                                                  hdr.IsQosData () ? hdr.GetQosTid () : 0,
+                                                                  modulation);
+    }
+
+  uint32_t ppduPayloadSize = mpdu->GetSize ();
+  if (modulation == WIFI_MOD_CLASS_HE)
+    {
+      // HE PPDUs always carry an S-MPDU
+      ppduPayloadSize = MpduAggregator::GetSizeIfAggregated (mpdu->GetSize (), 0);
+    }
+  if (maxAmpduSize > 0 && ppduPayloadSize > maxAmpduSize)
+    {
+      NS_LOG_DEBUG ("PPDU payload size (" << ppduPayloadSize << ") exceeds the maximum A-MPDU size");
+      return false;
+    }
+
+  Ptr<WifiPhy> phy = m_low->GetPhy ();
+  m_txDurationCache.SetPhyParameters (phy->GetChannelWidth (), phy->GetGuardInterval ().GetNanoSeconds (),
+                                      phy->GetFrequency ());
+  Time txTime = m_txDurationCache.GetTxDuration (ppduPayloadSize, muTxVector, staId);
+
+  if ((ppduDurationLimit.IsStrictlyPositive () && txTime > ppduDurationLimit)
+      || txTime > MicroSeconds (RR_OFDMA_PPDU_MAX_TIME_US))
+    {
+      NS_LOG_DEBUG ("TX duration (" << txTime.As (Time::US) << ") exceeds the limits");
+      return false;
+    }
+  return true;
+}
+
+void
+RrOfdmaManager::CandidateStore::Reserve (std::size_t n)
+{
+  aid.reserve (n);
+  address.reserve (n);
+  tid.reserve (n);
+  holSize.reserve (n);
+  backlog.reserve (n);
+  mode.reserve (n);
+  nss.reserve (n);
+  trafficClass.reserve (n);
+  metric.reserve (n);
+}
+
+void
+RrOfdmaManager::CandidateStore::Clear (void)
+{
+  aid.clear ();
+  address.clear ();
+  tid.clear ();
+  holSize.clear ();
+  backlog.clear ();
+  mode.clear ();
+  nss.clear ();
+  trafficClass.clear ();
+  metric.clear ();
+}
+
+uint16_t
+RrOfdmaManager::CandidateStore::Add (Mac48Address staAddress, uint16_t staAid, uint8_t staTid, uint32_t frameSize,
+                                     uint32_t queuedBytes, const SuTxInfo& suTxInfo, TrafficClass tc)
+{
+  NS_ASSERT (GetN () < RR_OFDMA_MAX_AID);
+  aid.push_back (staAid);
+  address.push_back (staAddress);
+  tid.push_back (staTid);
+  holSize.push_back (frameSize);
+  backlog.push_back (std::max (queuedBytes, frameSize));
+  mode.push_back (suTxInfo.mode);
+  nss.push_back (suTxInfo.nss);
+  trafficClass.push_back (tc);
+  metric.push_back (0.0);
+  return static_cast<uint16_t> (GetN () - 1);
+}
+
+std::size_t
+RrOfdmaManager::CandidateStore::GetN (void) const
+{
+  return aid.size ();
+}
+
+std::size_t
+RrOfdmaManager::CandidateStore::GetCapacity (void) const
+{
+  return aid.capacity () + address.capacity () + tid.capacity () + holSize.capacity ()
+         + backlog.capacity () + mode.capacity () + nss.capacity () + trafficClass.capacity ()
+         + metric.capacity ();
+}
+
+uint16_t
+RrOfdmaManager::AddCandidate (Mac48Address address, uint16_t aid, uint8_t tid, uint32_t holSize,
+                              const SuTxInfo& suTxInfo)
+{
+  uint16_t c = m_candidates.Add (address, aid, tid, holSize, m_nQueuedBytes[aid * 8 + tid],
+                                 suTxInfo, GetTrafficClass (aid));
+  m_ranking.push_back (c);
+  return c;
+}
+
+void
+RrOfdmaManager::RankCandidates (RankIt first, RankIt last, std::size_t k)
+{
+  // Stable partial selection sort in decreasing order of frame size: the
+  // largest remaining candidate (the first one in case of ties) is rotated
+  // into the next position, which preserves the relative order of the others.
+  // Only the first k positions are sorted, the others keep their relative order.
+  const std::vector<uint32_t>& holSize = m_candidates.holSize;
+  std::size_t n = std::min<std::size_t> (k, last - first);
+  for (std::size_t i = 0; i < n; i++)
+    {
+      RankIt max = first + i;
+      for (RankIt it = max + 1; it != last; it++)
+        {
+          if (holSize[*it] > holSize[*max])
+            {
+              max = it;
+            }
+        }
+      std::rotate (first + i, max, max + 1);
+    }
+}
+
+void
+RrOfdmaManager::SortByTrafficClass (std::size_t (&first)[TC_UNCLASSIFIED + 1],
+                                    std::size_t (&last)[TC_UNCLASSIFIED + 1])
+{
+  // counting sort of the candidates by traffic class
+  const std::vector<TrafficClass>& trafficClass = m_candidates.trafficClass;
+  std::size_t count[TC_UNCLASSIFIED + 1] = {0, 0, 0, 0};
+  for (uint16_t c : m_ranking)
+    {
+      count[trafficClass[c]]++;
+    }
+  NS_LOG_DEBUG (count[TC_UNCLASSIFIED] << " candidates have no traffic class");
+
+  std::size_t offset = 0;
+  for (auto tc : {TC_ON_OFF, TC_BULK_SEND, TC_HTTP, TC_UNCLASSIFIED})
+    {
+      first[tc] = last[tc] = offset;
+      offset += count[tc];
+    }
+
+  m_rankingScratch.resize (offset);
+  for (uint16_t c : m_ranking)
+    {
+      m_rankingScratch[last[trafficClass[c]]++] = c;
+    }
+  m_ranking.swap (m_rankingScratch);
+}
+
+std::size_t
+RrOfdmaManager::GetScratchCapacity (void) const
+{
+  return m_candidates.GetCapacity () + m_ranking.capacity () + m_ruAssigned.capacity ()
+         + m_rankingScratch.capacity () + m_candidateOrder.capacity () + m_ruValues.capacity ()
+         + m_topStations.capacity () + m_layoutChoice.capacity ();
+}
+
+void
+RrOfdmaManager::CheckScratchCapacity (void)
+{
+  std::size_t capacity = GetScratchCapacity ();
+  if (capacity != m_scratchCapacity)
+    {
+      // the scratch storage had to grow to accommodate the candidates
+      m_nScratchAllocations++;
+      m_scratchCapacity = capacity;
+    }
+}
+
+uint64_t
+RrOfdmaManager::GetNTxDurationCacheHits (void) const
+{
+  return m_txDurationCache.GetNHits ();
+}
+
+uint64_t
+RrOfdmaManager::GetNTxDurationCacheMisses (void) const
+{
+  return m_txDurationCache.GetNMisses ();
+}
+
+uint64_t
+RrOfdmaManager::GetNSuTxInfoHits (void) const
+{
+  return m_nSuTxInfoHits;
+}
+
+uint64_t
+RrOfdmaManager::GetNSuTxInfoMisses (void) const
+{
+  return m_nSuTxInfoMisses;
+}
+
+uint64_t
+RrOfdmaManager::GetNAckOverheadCacheHits (void) const
+{
+  return m_dlAckOverhead.GetNHits ();
+}
+
+uint64_t
+RrOfdmaManager::GetNAckOverheadCacheMisses (void) const
+{
+  return m_dlAckOverhead.GetNMisses ();
+}
+
+uint64_t
+RrOfdmaManager::GetNDlAckSequences (DlMuAckSequenceType dlMuAckSequence) const
+{
+  for (std::size_t i = 0; i < m_nDlAckSequences.size (); i++)
+    {
+      if (RR_OFDMA_DL_ACK_SEQUENCES[i] == dlMuAckSequence)
+        {
+          return m_nDlAckSequences[i];
+        }
+    }
+  return 0;
+}
+
+uint64_t
+RrOfdmaManager::GetNTxopPlans (void) const
+{
+  return m_nTxopPlans;
+}
+
+uint64_t
+RrOfdmaManager::GetNPlannedPpdus (void) const
+{
+  return m_nPlannedPpdus;
+}
+
+uint64_t
+RrOfdmaManager::GetNLookaheadHits (void) const
+{
+  return m_nLookaheadHits;
+}
+
+uint64_t
+RrOfdmaManager::GetNLookaheadMisses (void) const
+{
+  return m_nLookaheadMisses;
+}
+
+uint64_t
+RrOfdmaManager::GetNScratchAllocations (void) const
+{
+  return m_nScratchAllocations;
+}
+
+uint64_t
+RrOfdmaManager::GetNDecisionAllocations (void) const
+{
+  return m_nDecisionAllocations;
+}
+
+uint64_t
+RrOfdmaManager::GetNDecisions (void) const
+{
+  return m_nDecisions;
+}
+
+std::size_t
+RrOfdmaManager::AllocateRus (RankIt first, RankIt last, HeRu::RuType firstRuType,
+                             HeRu::RuType ruType, std::size_t maxRus)
+{
+  std::size_t nAllocated = 0;
+
+  for (RankIt it = first; it != last; it++)
+    {
+      if (m_ruAssigned.size () >= maxRus)
+        {
+          break;
+        }
+      HeRu::RuType type = (nAllocated == 0 ? firstRuType : ruType);
+      HeRu::RuSpec ru;
+      bool allocated = m_ruAllocator.Allocate (type, ru);
+      // fall back to smaller RUs if no RU of the given type is available
+      while (!allocated && type != HeRu::RU_26_TONE)
+        {
+          type = static_cast<HeRu::RuType> (type - 1);
+          allocated = m_ruAllocator.Allocate (type, ru);
+        }
+      if (!allocated)
+        {
+          // no room left in the channel
+          break;
+        }
+      m_ruAssigned.push_back (ru);
+      nAllocated++;
+    }
+  return nAllocated;
+}
+
+const std::vector<HeRu::RuSpec>&
+RrOfdmaManager::GetNumberAndTypeOfRus (uint16_t bandwidth, std::size_t& nStations)
+{
+  NS_LOG_FUNCTION (this << bandwidth << nStations);
+
+  if ((m_ruAllocationMode == RU_ALLOC_OPTIMAL || m_schedulingPolicy != SCHED_RR)
+      && !m_ranking.empty () && SolveRuPacking (bandwidth, nStations))
+    {
+      CheckScratchCapacity ();
+      return m_ruAssigned;
+    }
+
+  std::size_t nCandidates = m_ranking.size ();
+  m_ruAssigned.clear ();
+
+  // the candidates of each class are a contiguous range of m_ranking
+  std::size_t first[TC_UNCLASSIFIED + 1];
+  std::size_t last[TC_UNCLASSIFIED + 1];
+  SortByTrafficClass (first, last);
+
+  // Only the candidates that can be assigned an RU (and the first one that
+  // cannot, which is served first next time) need to be sorted
+  std::size_t nRanked = HeRuTonePlan::GetNRus (bandwidth, HeRu::RU_26_TONE) + 1;
+  for (auto tc : {TC_ON_OFF, TC_BULK_SEND, TC_HTTP, TC_UNCLASSIFIED})
+    {
+      RankCandidates (m_ranking.begin () + first[tc], m_ranking.begin () + last[tc], nRanked);
+    }
+  NS_LOG_DEBUG ("Candidates: " << nCandidates << " on/off: " << last[TC_ON_OFF] - first[TC_ON_OFF]
+                << " bulk send: " << last[TC_BULK_SEND] - first[TC_BULK_SEND]
+                << " http: " << last[TC_HTTP] - first[TC_HTTP]
+                << " unclassified: " << last[TC_UNCLASSIFIED] - first[TC_UNCLASSIFIED]);
+
+  // Unclassified candidates are not known to benefit from RUs of different
+  // sizes, hence they are served (along with all the other candidates) with
+  // RUs of equal size
+  if (last[TC_BULK_SEND] == first[TC_BULK_SEND] || m_ranking.size () <= 1
+      || last[TC_UNCLASSIFIED] > first[TC_UNCLASSIFIED])
+    {
+      // Assign RUs of equal size: select the smallest RU type such that all the
+      // RUs of that type in the channel can be assigned
+      HeRu::RuType ruType = HeRu::RU_2x996_TONE;
+      std::size_t nRus = 0;
+      for (std::size_t type = HeRu::RU_26_TONE; type < HeRuTonePlan::N_RU_TYPES; type++)
+        {
+          std::size_t n = HeRuTonePlan::GetNRus (bandwidth, static_cast<HeRu::RuType> (type));
+          if (n > 0 && n <= nStations)
+            {
+              ruType = static_cast<HeRu::RuType> (type);
+              nRus = n;
+              break;
+            }
+        }
+      if (nRus == 0)
+        {
+          NS_ASSERT (bandwidth == 160 && nStations == 1);
+          nRus = 1;
+        }
+      std::size_t nRusPerSegment = HeRuTonePlan::GetNRusPerSegment (bandwidth, ruType);
+      for (std::size_t i = 0; i < nRus; i++)
+        {
+          // at 160 MHz, RU indices restart from 1 in the secondary 80 MHz segment
+          m_ruAssigned.push_back ({i < nRusPerSegment, ruType, i % nRusPerSegment + 1});
+        }
+    }
+  else if (bandwidth <= 40)
+    {
+      // Assign RUs of different sizes by selecting the legal RU layout of the
+      // channel that maximizes the bytes delivered to the candidates
+      SelectRuLayout (bandwidth, nStations);
+    }
+  else
+    {
+      // Assign RUs of different sizes. On/off stations are served first with
+      // 26-tone RUs, then the bulk send station with the largest frame is assigned
+      // an RU spanning (up to) half of the channel and the other bulk send stations
+      // are assigned RUs spanning (up to) a quarter of the channel. Finally, HTTP
+      // stations are assigned 26-tone RUs. RUs are placed by the RU allocator, which
+      // falls back to smaller RUs when the requested ones do not fit.
+      HeRu::RuType halfRuType = HeRu::RU_106_TONE;
+      HeRu::RuType quarterRuType = HeRu::RU_52_TONE;
+      for (std::size_t type = HeRu::RU_26_TONE; type < HeRuTonePlan::N_RU_TYPES; type++)
+        {
+          std::size_t n = HeRuTonePlan::GetNRus (bandwidth, static_cast<HeRu::RuType> (type));
+          if (n == 2)
+            {
+              halfRuType = static_cast<HeRu::RuType> (type);
+            }
+          else if (n == 4)
+            {
+              quarterRuType = static_cast<HeRu::RuType> (type);
+            }
+        }
+
+      RankIt begin = m_ranking.begin ();
+      std::size_t nAssigned[TC_UNCLASSIFIED];
+      m_ruAllocator.Reset (bandwidth);
+      nAssigned[TC_ON_OFF] = AllocateRus (begin + first[TC_ON_OFF], begin + last[TC_ON_OFF],
+                                          HeRu::RU_26_TONE, HeRu::RU_26_TONE, nStations);
+      nAssigned[TC_BULK_SEND] = AllocateRus (begin + first[TC_BULK_SEND], begin + last[TC_BULK_SEND],
+                                             halfRuType, quarterRuType, nStations);
+      nAssigned[TC_HTTP] = AllocateRus (begin + first[TC_HTTP], begin + last[TC_HTTP],
+                                        HeRu::RU_26_TONE, HeRu::RU_26_TONE, nStations);
+
+      // rotate the candidates that are assigned an RU to the front (in the order
+      // their RUs were allocated), followed by the candidates that are not
+      RankIt assignedEnd = begin + first[TC_ON_OFF] + nAssigned[TC_ON_OFF];
+      for (auto tc : {TC_BULK_SEND, TC_HTTP})
+        {
+          assignedEnd = std::rotate (assignedEnd, begin + first[tc], begin + first[tc] + nAssigned[tc]);
+        }
+    }
+
+  nStations = m_ruAssigned.size ();
+  NS_LOG_DEBUG ("Assigned " << nStations << " RUs to " << m_ranking.size () << " candidates");
+
+  CheckScratchCapacity ();
+  return m_ruAssigned;
+}
+
+uint64_t
+RrOfdmaManager::GetDeliverableBytes (uint16_t candidate, HeRu::RuType ruType) const
+{
+  uint64_t rate = m_candidates.mode[candidate].GetDataRate (HeRu::GetBandwidth (ruType),
+                                                            m_low->GetPhy ()->GetGuardInterval ().GetNanoSeconds (),
+                                                            m_candidates.nss[candidate]);
+  return std::min<uint64_t> (m_candidates.backlog[candidate],
+                             static_cast<uint64_t> (rate * m_maxDlDuration.GetSeconds () / 8));
+}
+
+const RrOfdmaManager::SuTxInfo&
+RrOfdmaManager::GetSuTxInfo (uint16_t aid, Mac48Address address, Ptr<const WifiMacQueueItem> mpdu)
+{
+  NS_ASSERT (aid <= RR_OFDMA_MAX_AID);
+  SuTxInfo& info = m_suTxInfo[aid];
+  Time now = Simulator::Now ();
+
+  if (info.epoch == m_suTxInfoEpoch && now < info.expiry)
+    {
+      m_nSuTxInfoHits++;
+      return info;
+    }
+
+  m_nSuTxInfoMisses++;
+  WifiTxVector txVector;
+  if (mpdu != 0)
+    {
+      txVector = m_low->GetDataTxVector (mpdu);
+    }
+  else
+    {
+      if (m_suMpduSource != m_mpdu)
+        {
+          // m_mpdu cannot be modified, hence its header is changed on a copy
+          m_suMpdu = Copy (m_mpdu);
+          m_suMpduSource = m_mpdu;
+        }
+      m_suMpdu->GetHeader ().SetAddr1 (address);
+      txVector = m_low->GetDataTxVector (m_suMpdu);
+    }
+  info.mode = txVector.GetMode ();
+  info.nss = txVector.GetNss ();
+  info.expiry = now + m_suTxInfoLifetime;
+  info.epoch = m_suTxInfoEpoch;
+  return info;
+}
+
+void
+RrOfdmaManager::ComputeRuValues (uint16_t bandwidth, std::size_t nCandidates)
+{
+  NS_LOG_FUNCTION (this << bandwidth << nCandidates);
+
+  m_ruValues.assign (nCandidates * HeRuTonePlan::N_RU_TYPES, 0);
+  for (std::size_t i = 0; i < nCandidates; i++)
+    {
+      // with proportional fair scheduling, the bytes are weighted by the inverse
+      // of the average throughput of the candidate, while with earliest deadline
+      // first scheduling they are weighted by the urgency of the candidate
+      uint16_t c = m_ranking[i];
+      uint16_t aid = m_candidates.aid[c];
+      double weight = 1.0;
+      if (m_schedulingPolicy == SCHED_PF)
+        {
+          weight = RR_OFDMA_PF_VALUE_SCALE / std::max (GetAverageThroughput (aid), 1.0);
+        }
+      else if (m_schedulingPolicy == SCHED_EDF)
+        {
+          Time maxDelay = m_qosTxop[QosUtilsMapTidToAc (m_candidates.tid[c])]->GetWifiMacQueue ()->GetMaxDelay ();
+          double slack = (m_holDeadline[aid] - Simulator::Now ()).GetSeconds () / maxDelay.GetSeconds ();
+          weight = 1.0 + m_deadlineWeight * (1.0 - std::min (std::max (slack, 0.0), 1.0));
+        }
+
+      for (std::size_t type = HeRu::RU_26_TONE; type < HeRuTonePlan::N_RU_TYPES; type++)
+        {
+          if (HeRuTonePlan::GetNRus (bandwidth, static_cast<HeRu::RuType> (type)) == 0)
+            {
+              continue;
+            }
+          uint64_t bytes = GetDeliverableBytes (c, static_cast<HeRu::RuType> (type));
+          m_ruValues[i * HeRuTonePlan::N_RU_TYPES + type] = static_cast<uint64_t> (bytes * weight);
+        }
+    }
+}
+
+bool
+RrOfdmaManager::SolveRuPacking (uint16_t bandwidth, std::size_t& nStations)
+{
+  NS_LOG_FUNCTION (this << bandwidth << nStations);
+
+  std::size_t nCandidates = std::min (m_ranking.size (), nStations);
+  ComputeRuValues (bandwidth, nCandidates);
+  m_ruPackingSolver.SetBudget (m_solverBudget);
+  nCandidates = m_ruPackingSolver.Solve (bandwidth, m_ruValues, nCandidates);
+  if (nCandidates == 0 || m_ruPackingSolver.GetValue () == 0)
+    {
+      NS_LOG_DEBUG ("The RU packing solver found no solution, fall back to the heuristic");
+      return false;
+    }
+
+  // RUs are placed in decreasing order of size, which guarantees that they all fit
+  m_ruAssigned.clear ();
+  m_rankingScratch.clear ();
+  m_ruAllocator.Reset (bandwidth);
+  for (std::size_t type = HeRuTonePlan::N_RU_TYPES; type-- > 0; )
+    {
+      for (std::size_t i = 0; i < nCandidates; i++)
+        {
+          if (m_ruPackingSolver.IsAssigned (i)
+              && static_cast<std::size_t> (m_ruPackingSolver.GetRuType (i)) == type)
+            {
+              HeRu::RuSpec ru;
+              bool allocated = m_ruAllocator.Allocate (static_cast<HeRu::RuType> (type), ru);
+              NS_ASSERT_MSG (allocated, "The RUs selected by the solver do not fit in the channel");
+              m_ruAssigned.push_back (ru);
+              m_rankingScratch.push_back (m_ranking[i]);
+            }
+        }
+    }
+
+  // the candidates that are not assigned an RU follow the others
+  for (std::size_t i = 0; i < m_ranking.size (); i++)
+    {
+      if (i >= nCandidates || !m_ruPackingSolver.IsAssigned (i))
+        {
+          m_rankingScratch.push_back (m_ranking[i]);
+        }
+    }
+  m_ranking.swap (m_rankingScratch);
+  nStations = m_ruAssigned.size ();
+  NS_LOG_DEBUG ("Assigned " << nStations << " RUs to deliver " << m_ruPackingSolver.GetValue () << " bytes");
+  return true;
+}
+
+void
+RrOfdmaManager::SelectRuLayout (uint16_t bandwidth, std::size_t& nStations)
+{
+  NS_LOG_FUNCTION (this << bandwidth << nStations);
+  NS_ASSERT (bandwidth == 20 || bandwidth == 40);
+
+  using namespace HeRuTonePlan;
+  const uint8_t (*layouts)[N_LAYOUT_RU_TYPES] = (bandwidth == 20 ? RU_LAYOUTS_20MHZ : RU_LAYOUTS_40MHZ);
+  const std::size_t nLayouts = (bandwidth == 20 ? N_LAYOUTS_20MHZ : N_LAYOUTS_40MHZ);
+
+  std::size_t nCandidates = std::min (m_ranking.size (), nStations);
+  ComputeRuValues (bandwidth, nCandidates);
+
+  // score all the layouts by the maximum bytes their RUs can deliver to the
+  // candidates, then compute the assignment for the best layout
+  std::size_t best = 0;
+  uint64_t bestScore = 0;
+  for (std::size_t l = 0; l < nLayouts; l++)
+    {
+      uint64_t score = ScoreRuLayout (layouts[l], nCandidates, false);
+      if (l == 0 || score > bestScore)
+        {
+          best = l;
+          bestScore = score;
+        }
+    }
+  ScoreRuLayout (layouts[best], nCandidates, true);
+  NS_LOG_DEBUG ("Best layout: " << best << " score: " << bestScore);
+
+  // place the RUs of the best layout that are assigned to a candidate
+  m_ruAssigned.clear ();
+  m_rankingScratch.clear ();
+  m_ruAllocator.Reset (bandwidth);
+  for (std::size_t t = N_LAYOUT_RU_TYPES; t-- > 0; )
+    {
+      for (std::size_t i = 0; i < nCandidates; i++)
+        {
+          if (m_candidateOrder[i] == t)
+            {
+              HeRu::RuSpec ru;
+              bool allocated = m_ruAllocator.Allocate (static_cast<HeRu::RuType> (t), ru);
+              NS_ASSERT_MSG (allocated, "RU layout " << best << " does not fit in the channel");
+              m_rankingScratch.push_back (m_ranking[i]);
+              m_ruAssigned.push_back (ru);
+            }
+        }
+    }
+
+  // the candidates that are not assigned an RU follow the others
+  for (std::size_t i = 0; i < m_ranking.size (); i++)
+    {
+      if (i >= nCandidates || m_candidateOrder[i] == N_LAYOUT_RU_TYPES)
         {
-          m_dataInfo.push_back(*staInfoIt2);
-          staInfoIt2++;
-          allocated52-=1;
-          ruAssigned.push_back(std::make_pair(type2,in1++)); 
-          // ruAssigned.push_back(type2);
-          // ruIndexValues.push_back(in1++);
-          size3-=1;
+          m_rankingScratch.push_back (m_ranking[i]);
         }
-        while(allocated26>0 && size2>0)
+    }
+  m_ranking.swap (m_rankingScratch);
+  nStations = m_ruAssigned.size ();
+}
+
+uint64_t
+RrOfdmaManager::ScoreRuLayout (const uint8_t* layout, std::size_t nCandidates, bool assign)
+{
+  using namespace HeRuTonePlan;
+
+  // a state is the number of RUs of each type assigned so far, encoded in
+  // mixed radix (the radix of a type is one plus the number of its RUs)
+  std::size_t stride[N_LAYOUT_RU_TYPES];
+  std::size_t nStates = 1;
+  for (std::size_t t = 0; t < N_LAYOUT_RU_TYPES; t++)
+    {
+      stride[t] = nStates;
+      nStates *= layout[t] + 1;
+    }
+  NS_ASSERT (nStates <= MAX_LAYOUT_STATES);
+
+  // value[s] is the maximum number of bytes delivered to the candidates
+  // processed so far using at most the RUs counted by state s. The states are
+  // visited in decreasing order, hence the states a candidate is added to
+  // still refer to the previous candidates and a candidate gets at most one RU
+  uint64_t value[MAX_LAYOUT_STATES] = {};
+  if (assign)
+    {
+      m_layoutChoice.assign (nCandidates * nStates, 0);
+    }
+  for (std::size_t i = 0; i < nCandidates; i++)
+    {
+      const uint64_t* ruValues = &m_ruValues[i * N_RU_TYPES];
+      for (std::size_t s = nStates; s-- > 0; )
         {
-          m_dataInfo.push_back(*staInfoIt1);
-          staInfoIt1++;
-          allocated26-=1;
-          size2-=1;
-          ruAssigned.push_back(std::make_pair(type3,in2++));
-          // ruAssigned.push_back(type3);
-          // ruIndexValues.push_back(in2++);
+          uint8_t choice = 0;
+          for (std::size_t t = 0; t < N_LAYOUT_RU_TYPES; t++)
+            {
+              if ((s / stride[t]) % (layout[t] + 1) > 0 && value[s - stride[t]] + ruValues[t] > value[s])
+                {
+                  value[s] = value[s - stride[t]] + ruValues[t];
+                  choice = t + 1;
+                }
+            }
+          if (assign)
+            {
+              m_layoutChoice[i * nStates + s] = choice;
+            }
         }
-        while(allocated26>0 && size4>0)
+    }
+
+  if (assign)
+    {
+      // walk the choices back from the state including all the RUs
+      m_candidateOrder.resize (nCandidates);
+      std::size_t s = nStates - 1;
+      for (std::size_t i = nCandidates; i-- > 0; )
         {
-          m_dataInfo.push_back(*staInfoIt3);
-          staInfoIt3++;
-          allocated26-=1;
-          size4-=1;
-          ruAssigned.push_back(std::make_pair(type3,in2++)); 
-          // ruAssigned.push_back(type3);
-          // ruIndexValues.push_back(in2++);
+          uint8_t choice = m_layoutChoice[i * nStates + s];
+          m_candidateOrder[i] = (choice > 0 ? static_cast<std::size_t> (choice - 1) : N_LAYOUT_RU_TYPES);
+          if (choice > 0)
+            {
+              s -= stride[choice - 1];
+            }
         }
-        for(int i=0;i<size2;i++){m_dataInfo.push_back(*staInfoIt1);staInfoIt1++;}
-        for(int i=0;i<size3;i++){m_dataInfo.push_back(*staInfoIt2);staInfoIt2++;}
-        for(int i=0;i<size4;i++){m_dataInfo.push_back(*staInfoIt3);staInfoIt3++;}
-
-        NS_LOG_DEBUG("after "<<m_dataInfo.size());
-
-         // nStations = nRusAssigned;
-        return ruAssigned;
     }
-  }
-     
+  return value[nStates - 1];
 }
-    
-
 
-
-
-OfdmaManager::DlOfdmaInfo
-RrOfdmaManager::ComputeDlOfdmaInfo (void)
+void
+RrOfdmaManager::BuildDlSchedulingPlan (bool planned)
 {
-  NS_LOG_FUNCTION (this);
-
-  if (m_staInfo.empty ())
-    {
-      return DlOfdmaInfo ();
-    }
+  NS_LOG_FUNCTION (this << planned);
 
   uint16_t bw = m_low->GetPhy ()->GetChannelWidth ();
-//   uint16_t bw = m_bw;   // for TESTING only
 
   // compute how many stations can be granted an RU and the RU size
-  std::size_t nRusAssigned = m_dataInfo.size ();
-  std::vector<std::pair<HeRu::RuType,size_t>> ruAssigned = GetNumberAndTypeOfRus (bw, nRusAssigned,m_staInfo);
-// int size1=m_dataInfo.size()-1;
-  nRusAssigned=ruAssigned.size();
-NS_LOG_DEBUG (nRusAssigned);
-
-  DlOfdmaInfo dlOfdmaInfo;
-  auto staInfoIt = m_dataInfo.begin (); // iterator over the list of candidate receivers
+  std::size_t nRusAssigned = m_ranking.size ();
+  const std::vector<HeRu::RuSpec>& ruAssigned = GetNumberAndTypeOfRus (bw, nRusAssigned);
+  nRusAssigned = std::min (ruAssigned.size (), m_ranking.size ());
+  NS_LOG_DEBUG (nRusAssigned << " stations are assigned an RU");
 
+  m_dlPlan.dlOfdmaInfo = DlOfdmaInfo ();
+  DlOfdmaInfo& dlOfdmaInfo = m_dlPlan.dlOfdmaInfo;
   for (std::size_t i = 0; i < nRusAssigned; i++)
     {
-   NS_ASSERT (staInfoIt != m_dataInfo.end ());
-      std::pair <Mac48Address,DlPerStaInfo>p(std::get<0>(*staInfoIt),std::get<2>(*staInfoIt));
-      dlOfdmaInfo.staInfo.insert (p);
-      NS_LOG_DEBUG("sizeonly "<<dlOfdmaInfo.staInfo.size());
-      staInfoIt++;
+      uint16_t c = m_ranking[i];
+      dlOfdmaInfo.staInfo.insert ({m_candidates.address[c], DlPerStaInfo {m_candidates.aid[c], m_candidates.tid[c]}});
     }
-    
 
   // if not all the stations are assigned an RU, the first station to serve next
-  // time is the first one that was not served this time
-  if (nRusAssigned < m_dataInfo.size ())
+  // time is the first one that was not served this time. This does not apply
+  // to the PPDUs of the TXOP plan, after which the station to start with is
+  // the one set by the plan
+  if (!planned && nRusAssigned < m_ranking.size ())
     {
-      NS_ASSERT (staInfoIt != m_dataInfo.end ());
+      m_startStation = m_candidates.aid[m_ranking[nRusAssigned]];
+      NS_LOG_DEBUG ("Next station to serve has AID=" << m_startStation);
+    }
 
-      m_startStation = std::get<2>(*staInfoIt).aid;
-      NS_LOG_DEBUG ("Next station to serve has AID=" << m_startStation<<" "<<m_dataInfo.size());
+  if (m_dlAckSequenceSelection == ACK_SEQ_COST_MODEL)
+    {
+      m_dlMuAckSequence = SelectDlAckSequence (ruAssigned, nRusAssigned);
     }
- 
 
-  // set TX vector and TX params
-  InitTxVectorAndParams (dlOfdmaInfo.staInfo, ruAssigned, m_dlMuAckSequence);
+  // set TX vector and TX params, which includes assigning RUs to stations
+  InitTxVectorAndParams (ruAssigned, m_dlMuAckSequence);
   dlOfdmaInfo.params = m_txParams;
+  dlOfdmaInfo.txVector = m_txVector;
+
+  if (m_txParams.GetDlMuAckSequenceType () == DlMuAckSequenceType::DL_MU_BAR
+      || m_txParams.GetDlMuAckSequenceType () == DlMuAckSequenceType::DL_AGGREGATE_TF)
+    {
+      // The Trigger Frame to be returned is built from the TX vector used for the DL MU PPDU
+      // (i.e., responses will use the same set of RUs) and modified to ensure that responses
+      // are sent at a rate not higher than MCS 5.
+      dlOfdmaInfo.trigger = GetTriggerFrameHeader (dlOfdmaInfo.txVector, 5);
+      dlOfdmaInfo.trigger.SetUlLength (GetDlAckUlLength (LookupDlAckOverhead (), dlOfdmaInfo.trigger));
+      SetTargetRssi (dlOfdmaInfo.trigger);
+    }
 
-  // assign RUs to stations
+  m_dlPlan.nStations = nRusAssigned;
+  m_dlPlan.planned = planned;
+}
+
+DlMuAckSequenceType
+RrOfdmaManager::SelectDlAckSequence (const std::vector<HeRu::RuSpec>& ruAssigned, std::size_t nStations)
+{
+  NS_LOG_FUNCTION (this << nStations);
+
+  Ptr<WifiPhy> phy = m_low->GetPhy ();
+  m_txDurationCache.SetPhyParameters (phy->GetChannelWidth (), phy->GetGuardInterval ().GetNanoSeconds (),
+                                      phy->GetFrequency ());
 
-  // if (ruType == HeRu::RU_2x996_TONE)
-  //   {
-  //     HeRu::RuSpec ru = {true, ruType, 1};
-  //     NS_LOG_DEBUG ("STA " << m_staInfo.front ().first << " assigned " << ru);
-  //     m_txVector.SetRu (ru, m_staInfo.front ().second.aid);
-  //   }
-  // else
-  //   {
-      std::vector<bool> primary80MHzSet {true};
+  DlMuAckSequenceType best = m_dlMuAckSequence;
+  double bestGoodput = -1;
+  Time maxDataTime = m_maxDlDuration;
+  Time bestDataTime = m_maxDlDuration;
 
-      if (bw == 160)
+  for (DlMuAckSequenceType dlMuAckSequence : RR_OFDMA_DL_ACK_SEQUENCES)
+    {
+      InitTxVectorAndParams (ruAssigned, dlMuAckSequence);
+      Time response = GetDlResponseDuration ();
+      Time dataTime = Min (maxDataTime, MicroSeconds (RR_OFDMA_PPDU_MAX_TIME_US));
+      if (m_dlTxopRemaining.IsStrictlyPositive ())
+        {
+          dataTime = Min (dataTime, m_dlTxopRemaining - response);
+        }
+      if (!dataTime.IsStrictlyPositive ())
         {
-          primary80MHzSet.push_back (false);
-          bw = 80;
+          NS_LOG_DEBUG ("Ack sequence " << dlMuAckSequence << " does not fit in the remaining TXOP");
+          continue;
         }
 
-      auto mapIt = dlOfdmaInfo.staInfo.begin ();
-      NS_LOG_DEBUG("sizes "<< dlOfdmaInfo.staInfo.size() << " "<< nRusAssigned << " "<<ruAssigned.size());
-      auto ruIt=ruAssigned.begin();
-      // auto ruin1=ruIndexValues.begin();
-      for (auto primary80MHz : primary80MHzSet)
+      // GetDeliverableBytes caps the bytes at those that fit in m_maxDlDuration.
+      // The Trigger Frames aggregated to the A-MPDUs (if any) are neglected
+      m_maxDlDuration = dataTime;
+      uint64_t bytes = 0;
+      Time ppduDuration = Seconds (0);
+      bool fits = true;
+      for (std::size_t i = 0; i < nStations && fits; i++)
         {
-          for (std::size_t ruIndex = 1; ruIndex <= nRusAssigned; ruIndex++)
+          uint16_t c = m_ranking[i];
+          uint16_t aid = m_candidates.aid[c];
+          // TX vector including only the candidate, as required by the TX duration cache
+          WifiTxVector muTxVector;
+          muTxVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
+          muTxVector.SetChannelWidth (phy->GetChannelWidth ());
+          muTxVector.SetGuardInterval (phy->GetGuardInterval ().GetNanoSeconds ());
+          muTxVector.SetHeMuUserInfo (aid, {ruAssigned[i], m_candidates.mode[c], m_candidates.nss[c]});
+
+          uint64_t deliverable = GetDeliverableBytes (c, ruAssigned[i].ruType);
+          fits = (m_txDurationCache.GetTxDuration (m_candidates.holSize[c], muTxVector, aid) <= dataTime);
+          if (fits && deliverable > 0)
             {
-              NS_ASSERT (mapIt != dlOfdmaInfo.staInfo.end ());
-              HeRu::RuSpec ru = {primary80MHz, ruIt->first, ruIt->second};
-              NS_LOG_DEBUG ("STA " << mapIt->first << " assigned " << ru);
-              m_txVector.SetRu (ru, mapIt->second.aid);
-              mapIt++;
-              // ruin1++;
-              ruIt++;
+              bytes += deliverable;
+              ppduDuration = Max (ppduDuration, m_txDurationCache.GetTxDuration (deliverable, muTxVector, aid));
             }
         }
-    // }
-  dlOfdmaInfo.txVector = m_txVector;
+      if (!fits)
+        {
+          NS_LOG_DEBUG ("Ack sequence " << dlMuAckSequence << " leaves no room for a head-of-line frame");
+          continue;
+        }
 
-  if (m_txParams.GetDlMuAckSequenceType () == DlMuAckSequenceType::DL_MU_BAR
-      || m_txParams.GetDlMuAckSequenceType () == DlMuAckSequenceType::DL_AGGREGATE_TF)
+      double goodput = bytes / (ppduDuration + response).GetSeconds ();
+      NS_LOG_DEBUG ("Ack sequence " << dlMuAckSequence << ": " << bytes << " bytes in "
+                    << ppduDuration.As (Time::US) << " plus a response of " << response.As (Time::US));
+      if (goodput > bestGoodput)
+        {
+          best = dlMuAckSequence;
+          bestGoodput = goodput;
+          bestDataTime = dataTime;
+        }
+    }
+
+  m_maxDlDuration = bestDataTime;
+  NS_LOG_DEBUG ("Selected ack sequence " << best);
+  return best;
+}
+
+OfdmaManager::DlOfdmaInfo
+RrOfdmaManager::ComputeDlOfdmaInfo (void)
+{
+  NS_LOG_FUNCTION (this);
+  AllocationScope allocationScope (m_nDecisionAllocations);
+
+  if (m_ranking.empty ())
     {
-      Ptr<WifiRemoteStationManager> stationManager = GetWifiRemoteStationManager ();
-      // The Trigger Frame to be returned is built from the TX vector used for the DL MU PPDU
-      // (i.e., responses will use the same set of RUs) and modified to ensure that responses
-      // are sent at a rate not higher than MCS 5.
-      dlOfdmaInfo.trigger = GetTriggerFrameHeader (dlOfdmaInfo.txVector, 5);
-      dlOfdmaInfo.trigger.SetUlLength (m_low->CalculateUlLengthForBlockAcks (dlOfdmaInfo.trigger, m_txParams));
-      SetTargetRssi (dlOfdmaInfo.trigger);
+      // no candidate was selected or the plan was already handed over
+      return DlOfdmaInfo ();
+    }
+
+  // the plan was built by SelectTxFormat and the first candidates in m_ranking
+  // are the stations that are assigned an RU
+  const DlSchedulingPlan& plan = m_dlPlan;
+  NS_ASSERT (plan.nStations <= m_ranking.size ());
+
+  // update the average throughput of the stations with the bytes they are
+  // expected to receive in their RU
+  for (std::size_t i = 0; i < plan.nStations; i++)
+    {
+      uint16_t c = m_ranking[i];
+      uint16_t aid = m_candidates.aid[c];
+      const HeMuUserInfo& userInfo = plan.dlOfdmaInfo.txVector.GetHeMuUserInfo (aid);
+      UpdateAverageThroughput (aid, GetDeliverableBytes (c, userInfo.ru.ruType));
+    }
+
+  // plans made in advance may be discarded, hence plans are only counted when
+  // they are handed over
+  if (plan.newTxopPlan)
+    {
+      m_nTxopPlans++;
+    }
+  if (plan.planned)
+    {
+      m_nPlannedPpdus++;
+    }
+  for (std::size_t i = 0; i < m_nDlAckSequences.size (); i++)
+    {
+      if (RR_OFDMA_DL_ACK_SEQUENCES[i] == m_dlMuAckSequence)
+        {
+          m_nDlAckSequences[i]++;
+        }
+    }
+  if (m_lookahead)
+    {
+      // plan the next DL MU PPDU once the frames of this one have been dequeued
+      m_lookaheadEvent.Cancel ();
+      m_lookaheadEvent = Simulator::ScheduleNow (&RrOfdmaManager::Lookahead, this);
     }
-    // ruIndexValues.clear();
-    // ruAssigned.clear();
-  return dlOfdmaInfo;
+  // the plan is only handed over once, right after being built by SelectTxFormat.
+  // Clearing the ranking makes further calls return an empty DlOfdmaInfo
+  // instead of counting the plan again and returning the moved-from one
+  m_ranking.clear ();
+  m_dlPlan.nStations = 0;
+  return std::move (m_dlPlan.dlOfdmaInfo);
 }
 
 CtrlTriggerHeader
@@ -946,12 +2630,448 @@ RrOfdmaManager::GetTriggerFrameHeader (WifiTxVector dlMuTxVector, uint8_t maxMcs
   return CtrlTriggerHeader (TriggerFrameType::MU_BAR_TRIGGER, dlMuTxVector);
 }
 
+void
+RrOfdmaManager::NotifyMonitorSnifferRx (Ptr<const Packet> packet, uint16_t channelFreqMhz, WifiTxVector txVector,
+                                        MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId)
+{
+  WifiMacHeader hdr;
+  packet->PeekHeader (hdr);
+  if (!hdr.IsQosData () || hdr.GetAddr1 () != m_apMac->GetAddress ())
+    {
+      return;
+    }
+  auto it = m_aidMap.find (hdr.GetAddr2 ());
+  if (it == m_aidMap.end () || it->second > RR_OFDMA_MAX_AID)
+    {
+      return;
+    }
+  // the packet includes the MAC header and the FCS
+  uint32_t overhead = hdr.GetSerializedSize () + 4;
+  m_bsrEstimator.NotifyReceived (it->second, packet->GetSize () > overhead ? packet->GetSize () - overhead : 0);
+  if (m_raRuPending && txVector.GetPreambleType () == WIFI_PREAMBLE_HE_TB)
+    {
+      NotifyRaRuRx (hdr.GetAddr2 (), it->second, txVector);
+    }
+  if (m_ulPending && m_ulSolicited[it->second] == 1 && packet->GetSize () > overhead
+      && txVector.GetPreambleType () == WIFI_PREAMBLE_HE_TB)
+    {
+      // the solicited station responded with data
+      m_ulSolicited[it->second] = 2;
+      m_nUlResponded++;
+    }
+  // the buffer status carried by the frame is made available by the AP later
+  if (m_bsrReportTime[it->second].IsZero ())
+    {
+      Simulator::ScheduleNow (&RrOfdmaManager::ReadBufferStatus, this, it->second, hdr.GetAddr2 ());
+    }
+  m_bsrReportTime[it->second] = Simulator::Now ();
+}
+
+void
+RrOfdmaManager::ReadBufferStatus (uint16_t aid, Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << aid << address);
+  if (m_bsrReportTime[aid].IsZero ())
+    {
+      // the station left the BSS in the meantime
+      return;
+    }
+  Time reportTime = m_bsrReportTime[aid];
+  m_bsrReportTime[aid] = Seconds (0);
+
+  uint8_t queueSize = m_apMac->GetMaxBufferStatus (address);
+  SetUlUnlimited (aid, queueSize == 254);
+  if (queueSize >= 254)
+    {
+      // an unknown or not limited buffer status cannot be tracked by the estimator
+      m_bsrEstimator.Reset (aid);
+      return;
+    }
+  m_bsrEstimator.NotifyReport (aid, queueSize * 256, reportTime);
+  m_predictedAckTotal -= m_predictedAckBytes[aid];
+  m_predictedAckBytes[aid] = 0;
+}
+
+void
+RrOfdmaManager::SetUlUnlimited (uint16_t aid, bool unlimited)
+{
+  if (unlimited != (m_ulUnlimited[aid] != 0))
+    {
+      m_ulUnlimited[aid] = (unlimited ? 1 : 0);
+      m_nUlUnlimited = (unlimited ? m_nUlUnlimited + 1 : m_nUlUnlimited - 1);
+    }
+}
+
+uint32_t
+RrOfdmaManager::GetUlBufferSize (uint16_t aid, Mac48Address address) const
+{
+  uint8_t queueSize = m_apMac->GetMaxBufferStatus (address);
+  if (queueSize == 255)
+    {
+      NS_LOG_DEBUG ("Buffer status of station " << address << " is unknown");
+      return m_ulPsduSize;
+    }
+  if (queueSize == 254)
+    {
+      NS_LOG_DEBUG ("Buffer status of station " << address << " is not limited");
+      return 0xffffffff;
+    }
+
+  uint32_t reported = queueSize * 256;
+  if (!m_bsrEstimator.HasReport (aid) || m_bsrEstimator.GetReportedBytes (aid) != reported)
+    {
+      // the report has not been read yet
+      return reported;
+    }
+
+  uint32_t estimate = m_bsrEstimator.GetEstimate (aid, Simulator::Now ());
+  NS_LOG_DEBUG ("Buffer status of station " << address << " is " << +queueSize
+                << ", estimated buffer size " << estimate << " bytes");
+  return estimate;
+}
+
+Time
+RrOfdmaManager::GetUlExchangeOverhead (CtrlTriggerHeader& trigger, const MacLowTransmissionParameters& params)
+{
+  // the Trigger Frame is sent with the TX vector used for broadcast control frames
+  WifiTxVector tfTxVector = GetWifiRemoteStationManager ()->GetRtsTxVector (m_triggerHdr.GetAddr1 (),
+                                                                            &m_triggerHdr, m_triggerPayload);
+  if (!(m_ulOverhead.tfMode == tfTxVector.GetMode ())
+      || m_ulOverhead.ackSequence != m_ulMuAckSequence
+      || m_ulOverhead.channelWidth != m_ulTxVector.GetChannelWidth ()
+      || m_ulOverhead.guardInterval != m_ulTxVector.GetGuardInterval ())
+    {
+      NS_LOG_DEBUG ("Inputs of the UL exchange overhead model changed, rebuild the model");
+      m_ulOverhead.tfMode = tfTxVector.GetMode ();
+      m_ulOverhead.ackSequence = m_ulMuAckSequence;
+      m_ulOverhead.channelWidth = m_ulTxVector.GetChannelWidth ();
+      m_ulOverhead.guardInterval = m_ulTxVector.GetGuardInterval ();
+      std::fill (m_ulOverhead.overhead.begin (), m_ulOverhead.overhead.end (), Seconds (-1));
+    }
+
+  // the Trigger Frame includes a User Info field per solicited station and per RA-RU
+  std::size_t nUsers = m_ulStations.size ();
+  std::size_t nRaRus = m_raRus.size ();
+  NS_ASSERT (nRaRus < m_ulOverhead.nRaRuValues);
+  std::size_t index = nUsers * m_ulOverhead.nRaRuValues + nRaRus;
+  NS_ASSERT (index < m_ulOverhead.overhead.size ());
+  if (!m_ulOverhead.overhead[index].IsNegative ())
+    {
+      return m_ulOverhead.overhead[index];
+    }
+
+  // we need to define the HE TB PPDU duration in order to compute the response to
+  // the Trigger Frame. Let's use 1 ms for this purpose. We'll subtract it later.
+  uint16_t length = WifiPhy::ConvertHeTbPpduDurationToLSigLength (MilliSeconds (1),
+                                                                  m_low->GetPhy ()->GetFrequency ());
+  trigger.SetUlLength (length);
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (trigger);
+  Ptr<WifiMacQueueItem> item = Create<WifiMacQueueItem> (packet, m_triggerHdr);
+
+  Time response = m_low->GetResponseDuration (params, m_ulTxVector, item);
+
+  // Add the time to transmit the Trigger Frame itself
+  response += m_low->GetPhy ()->CalculateTxDuration (item->GetSize (), tfTxVector,
+                                                     m_low->GetPhy ()->GetFrequency ());
+
+  // Subtract the duration of the HE TB PPDU
+  response -= WifiPhy::ConvertLSigLengthToHeTbPpduDuration (length, m_ulTxVector,
+                                                            m_low->GetPhy ()->GetFrequency ());
+
+  NS_LOG_DEBUG ("Overhead of an UL exchange with " << nUsers << " users and " << nRaRus
+                << " RA-RUs: " << response);
+  m_ulOverhead.overhead[index] = response;
+  return response;
+}
+
+uint64_t
+RrOfdmaManager::GetDlBacklog (void) const
+{
+  uint64_t bytes = 0;
+  for (uint16_t aid = m_ringNext[0]; aid != 0; aid = m_ringNext[aid])
+    {
+      for (uint8_t tid = 0; tid < 8; tid++)
+        {
+          bytes += m_nQueuedBytes[aid * 8 + tid];
+        }
+    }
+  return bytes;
+}
+
+uint64_t
+RrOfdmaManager::GetUlBacklog (void) const
+{
+  // stations that did not report their buffer status only count for the
+  // acknowledgments they are expected to send, while stations whose buffer
+  // status is not limited count for the largest buffer status that can be
+  // reported
+  uint64_t bytes = std::min<uint64_t> (m_bsrEstimator.GetTotalEstimate (Simulator::Now ()),
+                                       m_bsrEstimator.GetNReports () * 254 * 256);
+  bytes += m_nUlUnlimited * 254 * 256;
+  bytes += static_cast<uint64_t> (std::max (m_predictedAckTotal, 0.0));
+  return bytes;
+}
+
+bool
+RrOfdmaManager::IsUlPreferred (void)
+{
+  if (m_txVector.GetHeMuUserInfoMap ().empty ())
+    {
+      // the stations to solicit are the receivers of the last DL MU PPDU
+      return false;
+    }
+  double ul = GetUlBacklog () * m_triggerEfficiency;
+  double dl = GetDlBacklog ();
+  double ulShare = (ul > 0 ? ul / (ul + dl) : 0);
+  NS_LOG_DEBUG ("Estimated UL backlog " << ul << " bytes (trigger efficiency " << m_triggerEfficiency
+                << "), DL backlog " << dl << " bytes, UL share of TXOPs " << m_ulServedShare);
+  // UL transmissions are tried if they have been served less than their share
+  return (ulShare > m_ulServedShare);
+}
+
+void
+RrOfdmaManager::CompleteUlExchange (void)
+{
+  NS_LOG_FUNCTION (this);
+  double efficiency = static_cast<double> (m_nUlResponded) / m_ulStations.size ();
+  m_triggerEfficiency += RR_OFDMA_TRIGGER_EFFICIENCY_WEIGHT * (efficiency - m_triggerEfficiency);
+  NS_LOG_DEBUG (m_nUlResponded << " out of " << m_ulStations.size () << " solicited stations responded,"
+                << " trigger efficiency " << m_triggerEfficiency);
+  for (auto& station : m_ulStations)
+    {
+      m_ulSolicited[station.aid] = 0;
+    }
+  m_ulPending = false;
+}
+
+double
+RrOfdmaManager::GetTriggerEfficiency (void) const
+{
+  return m_triggerEfficiency;
+}
+
+bool
+RrOfdmaManager::PlaceUlRus (uint16_t bandwidth)
+{
+  // RUs are placed in decreasing order of size, hence they fit in the channel
+  // if and only if all of them can be allocated
+  m_ruAllocator.Reset (bandwidth);
+  for (std::size_t type = HeRuTonePlan::N_RU_TYPES; type-- > 0; )
+    {
+      for (auto& station : m_ulStations)
+        {
+          if (static_cast<std::size_t> (station.ru.ruType) == type
+              && !m_ruAllocator.Allocate (station.ru.ruType, station.ru))
+            {
+              return false;
+            }
+        }
+    }
+  // RA-RUs are 26-tone RUs
+  for (auto& ru : m_raRus)
+    {
+      if (!m_ruAllocator.Allocate (HeRu::RU_26_TONE, ru))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+RrOfdmaManager::AllocateUlRus (uint16_t bandwidth, std::size_t nRaRus)
+{
+  NS_LOG_FUNCTION (this << bandwidth << nRaRus);
+  NS_ASSERT (!m_ulStations.empty () || nRaRus > 0);
+
+  // every station is initially assigned a 26-tone RU, after reserving the RA-RUs
+  std::size_t maxStations = HeRuTonePlan::GetNRus (bandwidth, HeRu::RU_26_TONE);
+  m_raRus.resize (std::min (nRaRus, maxStations));
+  maxStations -= m_raRus.size ();
+  if (m_ulStations.size () > maxStations)
+    {
+      NS_LOG_DEBUG ("Only the first " << maxStations << " stations can be solicited");
+      m_ulStations.resize (maxStations);
+    }
+  for (auto& station : m_ulStations)
+    {
+      station.ru.ruType = HeRu::RU_26_TONE;
+    }
+  bool placed = PlaceUlRus (bandwidth);
+  NS_ASSERT (placed);
+
+  // The HE TB PPDU lasts as long as required by the station needing the longest
+  // time to transmit its buffered frames, while the other stations pad their
+  // PSDUs. Hence, the RU of such station is enlarged as long as the RUs fit in
+  // the channel, which shortens the HE TB PPDU and the padding of the others
+  uint16_t guardInterval = m_low->GetPhy ()->GetGuardInterval ().GetNanoSeconds ();
+  while (!m_ulStations.empty ())
+    {
+      auto bottleneck = m_ulStations.end ();
+      double maxTxTime = 0;
+      for (auto it = m_ulStations.begin (); it != m_ulStations.end (); it++)
+        {
+          double txTime = it->bufferSize * 8.0
+                          / it->mode.GetDataRate (HeRu::GetBandwidth (it->ru.ruType), guardInterval, it->nss);
+          if (bottleneck == m_ulStations.end () || txTime > maxTxTime)
+            {
+              bottleneck = it;
+              maxTxTime = txTime;
+            }
+        }
+      if (bottleneck->ru.ruType == HeRu::RU_2x996_TONE
+          || HeRuTonePlan::GetNRus (bandwidth, static_cast<HeRu::RuType> (bottleneck->ru.ruType + 1)) == 0)
+        {
+          break;
+        }
+      bottleneck->ru.ruType = static_cast<HeRu::RuType> (bottleneck->ru.ruType + 1);
+      if (!PlaceUlRus (bandwidth))
+        {
+          bottleneck->ru.ruType = static_cast<HeRu::RuType> (bottleneck->ru.ruType - 1);
+          placed = PlaceUlRus (bandwidth);
+          NS_ASSERT (placed);
+          break;
+        }
+    }
+
+  m_ulTxVector = WifiTxVector ();
+  m_ulTxVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
+  m_ulTxVector.SetChannelWidth (m_low->GetPhy ()->GetChannelWidth ());
+  m_ulTxVector.SetGuardInterval (guardInterval);
+  m_ulTxVector.SetTxPowerLevel (GetWifiRemoteStationManager ()->GetDefaultTxPowerLevel ());
+  for (auto& station : m_ulStations)
+    {
+      NS_LOG_DEBUG ("Soliciting STA with AID=" << station.aid << " (buffer size="
+                    << station.bufferSize << ") in " << station.ru);
+      m_ulTxVector.SetHeMuUserInfo (station.aid, {station.ru, station.mode, station.nss});
+    }
+
+  // the TX vector used to compute the duration of frames sent in the RA-RUs
+  if (!m_raRus.empty ())
+    {
+      m_raTxVector = WifiTxVector ();
+      m_raTxVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
+      m_raTxVector.SetChannelWidth (m_low->GetPhy ()->GetChannelWidth ());
+      m_raTxVector.SetGuardInterval (guardInterval);
+      m_raTxVector.SetHeMuUserInfo (0, {m_raRus.front (), WifiPhy::GetHeMcs0 (), 1});
+    }
+}
+
+Time
+RrOfdmaManager::GetUlTxDuration (uint32_t size, uint16_t aid) const
+{
+  // the RA-RUs all have the same size and are used with the same MCS
+  return m_low->GetPhy ()->CalculateTxDuration (size, (aid == 0 ? m_raTxVector : m_ulTxVector),
+                                                m_low->GetPhy ()->GetFrequency (), aid);
+}
+
+void
+RrOfdmaManager::NotifyRaRuRx (Mac48Address address, uint16_t aid, const WifiTxVector& txVector)
+{
+  auto infoIt = txVector.GetHeMuUserInfoMap ().find (aid);
+  if (infoIt == txVector.GetHeMuUserInfoMap ().end ())
+    {
+      return;
+    }
+  const HeRu::RuSpec& ru = infoIt->second.ru;
+  for (std::size_t i = 0; i < m_raRus.size (); i++)
+    {
+      if (m_raRus[i].primary80MHz == ru.primary80MHz && m_raRus[i].ruType == ru.ruType
+          && m_raRus[i].index == ru.index)
+        {
+          // count the distinct stations transmitting in the RA-RU
+          if (m_raRuNStations[i] == 0 || m_raRuStation[i] != address)
+            {
+              m_raRuNStations[i]++;
+              m_raRuStation[i] = address;
+            }
+          return;
+        }
+    }
+}
+
+void
+RrOfdmaManager::CompleteRaRus (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::size_t i = 0; i < m_raRus.size (); i++)
+    {
+      if (m_raRuNStations[i] == 1)
+        {
+          NS_LOG_DEBUG ("RA-RU " << i << " used by " << m_raRuStation[i]);
+          m_nRaRuSuccesses[i]++;
+          m_raRuSuccessTrace (i, m_raRuStation[i]);
+        }
+      else if (m_raRuNStations[i] > 1)
+        {
+          NS_LOG_DEBUG ("RA-RU " << i << " used by " << +m_raRuNStations[i] << " stations");
+          m_nRaRuCollisions[i]++;
+          m_raRuCollisionTrace (i, m_raRuNStations[i]);
+        }
+    }
+  m_raRuPending = false;
+}
+
+uint64_t
+RrOfdmaManager::GetNRaRuSuccesses (uint8_t index) const
+{
+  return (index < m_nRaRuSuccesses.size () ? m_nRaRuSuccesses[index] : 0);
+}
+
+uint64_t
+RrOfdmaManager::GetNRaRuCollisions (uint8_t index) const
+{
+  return (index < m_nRaRuCollisions.size () ? m_nRaRuCollisions[index] : 0);
+}
+
+void
+RrOfdmaManager::AddRaRuUserInfoFields (CtrlTriggerHeader& trigger) const
+{
+  // add a User Info field with AID 0 (RA-RU for associated stations) for each RA-RU
+  for (auto& ru : m_raRus)
+    {
+      CtrlTriggerUserInfoField& userInfo = trigger.AddUserInfoField ();
+      userInfo.SetAid12 (0);
+      userInfo.SetRuAllocation (ru);
+      userInfo.SetUlFecCodingType (true);
+      userInfo.SetUlMcs (0);
+      userInfo.SetUlDcm (false);
+      userInfo.SetSsAllocation (1, 1);
+      userInfo.SetRaRuInformation (1, false);
+    }
+}
+
 OfdmaManager::UlOfdmaInfo
 RrOfdmaManager::ComputeUlOfdmaInfo (void)
 {
-  CtrlTriggerHeader trigger (TriggerFrameType::BASIC_TRIGGER, m_txVector);
-  trigger.SetUlLength (m_txVector.GetLength ());
+  CtrlTriggerHeader trigger (TriggerFrameType::BASIC_TRIGGER, m_ulTxVector);
+  trigger.SetUlLength (m_ulTxVector.GetLength ());
   SetTargetRssi (trigger);
+  AddRaRuUserInfoFields (trigger);
+
+  // the response of the solicited stations is known at the next scheduling decision
+  for (auto& station : m_ulStations)
+    {
+      m_ulSolicited[station.aid] = 1;
+    }
+  m_nUlResponded = 0;
+  m_ulPending = !m_ulStations.empty ();
+
+  if (!m_raRus.empty ())
+    {
+      // the outcome of the RA-RUs is known at the next scheduling decision
+      if (m_nRaRuSuccesses.size () < m_raRus.size ())
+        {
+          m_nRaRuSuccesses.resize (m_raRus.size (), 0);
+          m_nRaRuCollisions.resize (m_raRus.size (), 0);
+          m_raRuStation.resize (m_raRus.size ());
+          m_raRuNStations.resize (m_raRus.size ());
+        }
+      std::fill (m_raRuNStations.begin (), m_raRuNStations.end (), 0);
+      m_raRuPending = true;
+    }
 
   UlOfdmaInfo ulOfdmaInfo;
   ulOfdmaInfo.params = m_txParams;
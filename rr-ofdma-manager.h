@@ -22,7 +22,24 @@
 #define RR_OFDMA_MANAGER_H
 
 #include "ofdma-manager.h"
-#include <list>
+#include "ru-allocator.h"
+#include "ru-packing-solver.h"
+#include "tx-duration-cache.h"
+#include "buffer-status-estimator.h"
+#include "ack-overhead-cache.h"
+#include "originator-block-ack-agreement.h"
+#include "ns3/traced-callback.h"
+#include "ns3/event-id.h"
+#include <map>
+#include <string>
+#include <vector>
+
+class RrOfdmaLookaheadInvalidationTest;
+class RrOfdmaAllocationTest;
+class RrOfdmaRankingTest;
+class RrOfdmaDecisionCacheTest;
+class RrOfdmaTxopPlanTest;
+class RrOfdmaRuLayoutTest;
 
 namespace ns3 {
 
@@ -34,11 +51,24 @@ namespace ns3 {
  * RrOfdmaManager assigns RUs of equal size (in terms of tones) to stations to
  * which the AP has frames to transmit belonging to the AC who gained access to the
  * channel or higher. The maximum number of stations that can be granted an RU
- * is configurable. Associated stations are served in a round robin fashion.
+ * is configurable. Associated stations to which the AP has frames to transmit
+ * (which are kept in a ring sorted by AID) are served in a round robin fashion or,
+ * if the proportional fair policy is selected, based on the ratio between their
+ * instantaneous rate and the average throughput they have recently received or,
+ * if the earliest deadline first policy is selected, based on the expiry time
+ * of their head-of-line frames.
  */
 class RrOfdmaManager : public OfdmaManager
 {
 public:
+  /// Allow test cases to access private members
+  friend class ::RrOfdmaLookaheadInvalidationTest;
+  friend class ::RrOfdmaAllocationTest;
+  friend class ::RrOfdmaRankingTest;
+  friend class ::RrOfdmaDecisionCacheTest;
+  friend class ::RrOfdmaTxopPlanTest;
+  friend class ::RrOfdmaRuLayoutTest;
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -47,9 +77,361 @@ public:
   RrOfdmaManager ();
   virtual ~RrOfdmaManager ();
 
+  /**
+   * Traffic classes used to decide the size of the RU assigned to a station
+   */
+  enum TrafficClass : uint8_t
+  {
+    TC_BULK_SEND = 0,
+    TC_ON_OFF,
+    TC_HTTP,
+    TC_UNCLASSIFIED
+  };
+
+  /**
+   * Algorithms used to assign RUs to the candidate stations
+   */
+  enum RuAllocationMode : uint8_t
+  {
+    RU_ALLOC_HEURISTIC = 0,
+    RU_ALLOC_OPTIMAL
+  };
 
+  /**
+   * Policies used to select the stations to serve
+   */
+  enum SchedulingPolicy : uint8_t
+  {
+    SCHED_RR = 0,
+    SCHED_PF,
+    SCHED_EDF
+  };
+
+  /**
+   * Methods used to select the format of the next transmission
+   */
+  enum TxFormatSelection : uint8_t
+  {
+    FORMAT_ALTERNATE = 0,
+    FORMAT_ADAPTIVE
+  };
+
+  /**
+   * Methods used to select the ack sequence of DL MU PPDUs
+   */
+  enum DlAckSequenceSelection : uint8_t
+  {
+    ACK_SEQ_POLICY = 0,
+    ACK_SEQ_COST_MODEL
+  };
+
+  /**
+   * Set the traffic class of the station with the given AID.
+   *
+   * \param aid the AID of the station
+   * \param trafficClass the traffic class of the station
+   */
+  void SetTrafficClass (uint16_t aid, TrafficClass trafficClass);
+  /**
+   * Get the traffic class of the station with the given AID.
+   *
+   * \param aid the AID of the station
+   * \return the traffic class of the station
+   */
+  TrafficClass GetTrafficClass (uint16_t aid) const;
+
+  /**
+   * Get the exponentially weighted moving average of the throughput delivered
+   * to the station with the given AID, as used by proportional fair scheduling.
+   *
+   * \param aid the AID of the station
+   * \return the average throughput in bytes per second
+   */
+  double GetAverageThroughput (uint16_t aid) const;
+
+  /**
+   * Get the number of times the storage used to rank the candidate stations
+   * had to grow. Such storage is reused across scheduling decisions, hence
+   * this counter does not increase once the storage has reached its steady
+   * state size (it is reserved for the maximum number of RUs at construction).
+   *
+   * \return the number of times the ranking scratch storage was reallocated
+   */
+  uint64_t GetNScratchAllocations (void) const;
+  /**
+   * Get the total number of heap allocations made while taking scheduling
+   * decisions (i.e., by SelectTxFormat and ComputeDlOfdmaInfo). Allocations are
+   * only counted if an allocation counter is installed (see AllocationScope),
+   * otherwise this function returns zero.
+   *
+   * \return the number of heap allocations made by scheduling decisions
+   */
+  uint64_t GetNDecisionAllocations (void) const;
+  /**
+   * \return the number of scheduling decisions (calls to SelectTxFormat) taken
+   */
+  uint64_t GetNDecisions (void) const;
+
+  /**
+   * \return the number of TX durations of candidate frames found in the cache
+   */
+  uint64_t GetNTxDurationCacheHits (void) const;
+  /**
+   * \return the number of TX durations of candidate frames that were computed
+   */
+  uint64_t GetNTxDurationCacheMisses (void) const;
+  /**
+   * \return the number of times the SU TX info of a station was found in the cache
+   */
+  uint64_t GetNSuTxInfoHits (void) const;
+  /**
+   * \return the number of times the SU TX info of a station was queried to the
+   *         remote station manager
+   */
+  uint64_t GetNSuTxInfoMisses (void) const;
+  /**
+   * \return the number of times the overhead of a DL ack sequence was found in the cache
+   */
+  uint64_t GetNAckOverheadCacheHits (void) const;
+  /**
+   * \return the number of times the overhead of a DL ack sequence was not found in the cache
+   */
+  uint64_t GetNAckOverheadCacheMisses (void) const;
+  /**
+   * \param dlMuAckSequence the ack sequence type
+   * \return the number of DL MU PPDUs that were acknowledged through the given ack sequence
+   */
+  uint64_t GetNDlAckSequences (DlMuAckSequenceType dlMuAckSequence) const;
+  /**
+   * \return the number of times the DL MU PPDUs of a TXOP were planned
+   */
+  uint64_t GetNTxopPlans (void) const;
+  /**
+   * \return the number of DL MU PPDUs that served the stations planned for them
+   */
+  uint64_t GetNPlannedPpdus (void) const;
+  /**
+   * \return the number of DL MU PPDUs planned in advance that were committed
+   */
+  uint64_t GetNLookaheadHits (void) const;
+  /**
+   * \return the number of DL MU PPDUs planned in advance that were discarded
+   *         because the state they were planned on changed
+   */
+  uint64_t GetNLookaheadMisses (void) const;
+
+  /**
+   * \param index the index of an RA-RU (in the order RA-RUs appear in Basic Trigger Frames)
+   * \return the number of times frames from a single station were received in the RA-RU
+   */
+  uint64_t GetNRaRuSuccesses (uint8_t index) const;
+  /**
+   * Get the trigger efficiency, i.e., the exponentially weighted moving average
+   * of the fraction of the stations solicited by a Basic Trigger Frame (in a
+   * dedicated RU) that responded with data frames.
+   *
+   * \return the trigger efficiency
+   */
+  double GetTriggerEfficiency (void) const;
+  /**
+   * \param index the index of an RA-RU (in the order RA-RUs appear in Basic Trigger Frames)
+   * \return the number of times frames from multiple stations were received in the RA-RU
+   */
+  uint64_t GetNRaRuCollisions (uint8_t index) const;
+
+  /**
+   * TracedCallback signature for successful RA-RUs.
+   *
+   * \param index the index of the RA-RU
+   * \param address the MAC address of the station that used the RA-RU
+   */
+  typedef void (* RaRuSuccessCallback)(uint8_t index, Mac48Address address);
+  /**
+   * TracedCallback signature for RA-RU collisions.
+   *
+   * \param index the index of the RA-RU
+   * \param nStations the number of stations that used the RA-RU
+   */
+  typedef void (* RaRuCollisionCallback)(uint8_t index, uint8_t nStations);
 
 private:
+  /**
+   * Set the traffic class of ranges of AIDs. The given string is a semicolon
+   * separated list of entries of the form CLASS:FIRST-LAST (or CLASS:AID),
+   * where CLASS is one of BulkSend, OnOff or Http. Stations not covered by
+   * any entry are unclassified and, when they are candidates, all the candidates
+   * are assigned RUs of equal size. The simulation is aborted if the string is
+   * malformed or an AID exceeds the maximum AID.
+   *
+   * \param classes the traffic class map
+   */
+  void SetTrafficClassMap (std::string classes);
+  /**
+   * \return the traffic class map last set through SetTrafficClassMap
+   */
+  std::string GetTrafficClassMap (void) const;
+
+  /**
+   * Connect the trace sources of the EDCA queues, of the Block Ack manager
+   * retransmit queues and of the AP that keep the backlog index up to date,
+   * and initialize the backlog index with the frames currently queued.
+   */
+  void ConnectBacklogTraces (void);
+  /**
+   * Initialize the backlog index of the given station with the frames
+   * currently queued for it.
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   */
+  void InitBacklog (uint16_t aid, Mac48Address address);
+  /**
+   * Notify that the given station has associated with the AP.
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   */
+  void NotifyAssociation (uint16_t aid, Mac48Address address);
+  /**
+   * Notify that the given station has disassociated from the AP.
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   */
+  void NotifyDisassociation (uint16_t aid, Mac48Address address);
+  /**
+   * Set the state of the Block Ack agreement with the given station for the
+   * given TID in the BA state table. The BAR and BA types are read from the
+   * QosTxop when the agreement is established.
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   * \param tid the TID
+   * \param established whether the agreement is established
+   */
+  void SetBaState (uint16_t aid, Mac48Address address, uint8_t tid, bool established);
+  /**
+   * Refresh the state of all the Block Ack agreements with the given station
+   * from the QosTxops.
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   */
+  void RefreshBaState (uint16_t aid, Mac48Address address);
+  /**
+   * Notify that the state of the Block Ack agreement with the given recipient
+   * for the given TID has changed.
+   *
+   * \param now the time of the state change
+   * \param recipient the recipient of the Block Ack agreement
+   * \param tid the TID
+   * \param state the new state of the agreement
+   */
+  void NotifyAgreementState (Time now, Mac48Address recipient, uint8_t tid,
+                             OriginatorBlockAckAgreement::State state);
+  /**
+   * Notify that the transmission of an MPDU to the given station failed for
+   * the last time. The BA state table entries of the station are refreshed.
+   *
+   * \param address the MAC address of the station
+   */
+  void NotifyTxFinalDataFailed (Mac48Address address);
+  /**
+   * Notify that the transmission of an MPDU to the given station failed. The
+   * cached SU TX info of the station is discarded.
+   *
+   * \param address the MAC address of the station
+   */
+  void NotifyTxDataFailed (Mac48Address address);
+  /**
+   * Notify that the rate selected by the remote station manager changed. The
+   * cached SU TX info of all the stations is discarded.
+   *
+   * \param oldRate the previous rate
+   * \param newRate the new rate
+   */
+  void NotifyRateChange (uint64_t oldRate, uint64_t newRate);
+  /**
+   * \param aid the AID of a station
+   * \return whether the station is in the ring of backlogged stations
+   */
+  bool IsActiveStation (uint16_t aid) const;
+  /**
+   * Insert the given station in (or remove it from) the ring of backlogged
+   * stations depending on whether the AP has frames queued for it.
+   *
+   * \param aid the AID of the station
+   */
+  void UpdateActiveStation (uint16_t aid);
+  /**
+   * \param aid an AID
+   * \return the AID of the first backlogged station whose AID is not less than
+   *         the given one (wrapping around), or 0 if no station is backlogged
+   */
+  uint16_t FindActiveStation (uint16_t aid) const;
+  /**
+   * \param aid the AID of a station
+   * \return the AID of the backlogged station following the given one in round
+   *         robin order, or 0 if no station is backlogged
+   */
+  uint16_t GetNextActiveStation (uint16_t aid) const;
+  /**
+   * Get the AID of the associated station having the given MAC address.
+   *
+   * \param address the MAC address of the station
+   * \return the AID of the station or 0 if the station is not associated
+   */
+  uint16_t GetAid (Mac48Address address);
+  /**
+   * Notify that the given MPDU has been enqueued.
+   *
+   * \param item the MPDU
+   */
+  void NotifyEnqueue (Ptr<const WifiMacQueueItem> item);
+  /**
+   * Notify that the given MPDU has been dequeued (or removed because expired).
+   *
+   * \param item the MPDU
+   */
+  void NotifyDequeue (Ptr<const WifiMacQueueItem> item);
+  /**
+   * Notify that the MPDU with the given header has been acknowledged. A
+   * bulk-send station is expected to send TCP acknowledgments for the
+   * segments it received.
+   *
+   * \param hdr the MAC header of the MPDU
+   */
+  void NotifyTxOk (const WifiMacHeader& hdr);
+  /**
+   * Update the backlog index after the given MPDU has been enqueued or dequeued.
+   *
+   * \param item the MPDU
+   * \param enqueued true if the MPDU has been enqueued, false if dequeued
+   */
+  void UpdateBacklog (Ptr<const WifiMacQueueItem> item, bool enqueued);
+  /**
+   * Update the average throughput of the station with the given AID after
+   * the given amount of bytes has been scheduled for transmission to it.
+   *
+   * \param aid the AID of the station
+   * \param bytes the number of bytes
+   */
+  void UpdateAverageThroughput (uint16_t aid, uint64_t bytes);
+  /**
+   * Check whether the given MPDU, transmitted to the given station in an HE MU
+   * PPDU using the given TX vector, meets the A-MPDU size limit of the receiver
+   * and the given PPDU duration limit. This is equivalent to
+   * MacLow::IsWithinSizeAndTimeLimits, but TX durations are memoized.
+   *
+   * \param mpdu the MPDU
+   * \param muTxVector the TX vector, including the receiver station only
+   * \param staId the STA-ID of the receiver station
+   * \param ppduDurationLimit the PPDU duration limit (ignored if not strictly positive)
+   * \return true if the MPDU meets the size and time limits
+   */
+  bool IsWithinSizeAndTimeLimits (Ptr<const WifiMacQueueItem> mpdu, const WifiTxVector& muTxVector,
+                                  uint16_t staId, Time ppduDurationLimit);
+
   /**
    * Select the format of the next transmission, assuming that the AP gained
    * access to the channel to transmit the given MPDU.
@@ -68,6 +450,24 @@ private:
    
   virtual DlOfdmaInfo ComputeDlOfdmaInfo (void);
 
+  /**
+   * Build the plan for the DL MU PPDU to transmit to the candidate stations
+   * selected by SelectTxFormat, i.e., assign RUs to the candidate stations and
+   * compute the TX vector, the TX params and the Trigger Frame (if needed).
+   * The plan is then handed over by ComputeDlOfdmaInfo without recomputing it.
+   *
+   * \param planned whether the DL MU PPDU is one of the PPDUs of the TXOP plan
+   */
+  void BuildDlSchedulingPlan (bool planned);
+
+  /**
+   * Append a User Info field with AID 0 to the given Trigger Frame for each
+   * RA-RU in m_raRus.
+   *
+   * \param trigger the Trigger Frame
+   */
+  void AddRaRuUserInfoFields (CtrlTriggerHeader& trigger) const;
+
   /**
    * Prepare the information required to solicit an UL OFDMA transmission.
    *
@@ -77,28 +477,616 @@ private:
 
   /**
    * Given the channel bandwidth and the number of stations candidate for being
-   * assigned an RU, maximize the number of candidate stations that can be assigned
-   * an RU subject to the constraint that all the stations must be assigned an RU
-   * of the same size (in terms of number of tones).
+   * assigned an RU, assign RUs to the candidate stations. If there is no bulk
+   * send candidate or some candidate is unclassified, all the stations are
+   * assigned RUs of the same size (in terms of number of tones) and the number
+   * of stations that are assigned an RU is maximized. Otherwise, RUs of
+   * different sizes are assigned by selecting the best RU layout (20 and 40 MHz
+   * channels) or depending on the traffic class of the stations (wider
+   * channels). With the optimal RU allocation mode or with proportional fair
+   * scheduling, RUs are assigned by SolveRuPacking.
+   *
+   * \param bandwidth the channel bandwidth in MHz
+   * \param nStations the maximum number of stations that can be assigned an RU.
+   *                  On return, it is set to the number of assigned RUs
+   * \return the RUs assigned to the first candidates in m_ranking (which is
+   *         reordered by this function)
+   */
+  const std::vector<HeRu::RuSpec>& GetNumberAndTypeOfRus (uint16_t bandwidth, std::size_t& nStations);
+
+  /// The (cached) mode and NSS used to transmit single user frames to a station
+  struct SuTxInfo
+  {
+    WifiMode mode;    //!< the mode
+    uint8_t nss;      //!< the number of spatial streams
+    Time expiry;      //!< the time the entry expires
+    uint32_t epoch;   //!< the epoch the entry was stored in (0 if invalidated)
+  };
+
+  /**
+   * The candidate stations of a scheduling decision, stored as parallel arrays
+   * indexed by the order in which candidates are added. Candidates are never
+   * moved: they are ranked by permuting their indices (see m_ranking), so that
+   * the loops scoring and ranking candidates stream through contiguous arrays.
+   */
+  struct CandidateStore
+  {
+    std::vector<uint16_t> aid;                 //!< AID of the station
+    std::vector<Mac48Address> address;         //!< MAC address of the station
+    std::vector<uint8_t> tid;                  //!< TID of the frames to send
+    std::vector<uint32_t> holSize;             //!< size of the head-of-line frame
+    std::vector<uint32_t> backlog;             //!< bytes queued for the TID (at least holSize)
+    std::vector<WifiMode> mode;                //!< MCS used to transmit single user frames
+    std::vector<uint8_t> nss;                  //!< number of spatial streams used for single user frames
+    std::vector<TrafficClass> trafficClass;    //!< traffic class of the station
+    std::vector<double> metric;                //!< metric of the scheduling policy
+
+    /**
+     * Reserve storage for the given number of candidates.
+     *
+     * \param n the number of candidates
+     */
+    void Reserve (std::size_t n);
+    /**
+     * Remove all the candidates (storage is retained).
+     */
+    void Clear (void);
+    /**
+     * Add a candidate. Its metric is initialized to zero.
+     *
+     * \param staAddress the MAC address of the station
+     * \param staAid the AID of the station
+     * \param staTid the TID of the frames to send
+     * \param frameSize the size of the head-of-line frame
+     * \param queuedBytes the bytes queued for the TID
+     * \param suTxInfo the mode and NSS used to transmit single user frames to the station
+     * \param tc the traffic class of the station
+     * \return the index of the candidate
+     */
+    uint16_t Add (Mac48Address staAddress, uint16_t staAid, uint8_t staTid, uint32_t frameSize,
+                  uint32_t queuedBytes, const SuTxInfo& suTxInfo, TrafficClass tc);
+    /**
+     * \return the number of candidates
+     */
+    std::size_t GetN (void) const;
+    /**
+     * \return the sum of the capacities of the candidate arrays
+     */
+    std::size_t GetCapacity (void) const;
+  };
+
+  /// The DL MU PPDU planned by SelectTxFormat and returned by ComputeDlOfdmaInfo
+  struct DlSchedulingPlan
+  {
+    DlOfdmaInfo dlOfdmaInfo;  //!< receiver stations, TX vector, TX params and Trigger Frame
+    std::size_t nStations;    //!< number of stations (the first candidates in m_ranking) assigned an RU
+    bool planned;             //!< whether the PPDU is one of the PPDUs of the TXOP plan
+    bool newTxopPlan;         //!< whether the TXOP plan was made when selecting the PPDU
+  };
+
+  /// A view over a contiguous range of m_ranking
+  typedef std::vector<uint16_t>::iterator RankIt;
+
+  /**
+   * Add a candidate station to m_candidates and append it to m_ranking.
+   *
+   * \param address the MAC address of the station
+   * \param aid the AID of the station
+   * \param tid the TID of the frames to send
+   * \param holSize the size of the head-of-line frame
+   * \param suTxInfo the mode and NSS used to transmit single user frames to the station
+   * \return the index of the candidate
+   */
+  uint16_t AddCandidate (Mac48Address address, uint16_t aid, uint8_t tid, uint32_t holSize,
+                         const SuTxInfo& suTxInfo);
+  /**
+   * Sort (in a stable manner) the first k candidates of the given range of
+   * m_ranking in decreasing order of the size of the head-of-line frame. The
+   * candidates that are not among the first k keep their relative order. No
+   * memory is allocated.
+   *
+   * \param first the beginning of the range of candidates to rank
+   * \param last the end of the range of candidates to rank
+   * \param k the number of candidates to sort
+   */
+  void RankCandidates (RankIt first, RankIt last, std::size_t k);
+  /**
+   * Sort (in a stable manner) the candidates in m_ranking by traffic class,
+   * so that the candidates of each class are contiguous (on/off candidates
+   * first, then bulk send, HTTP and unclassified candidates).
+   *
+   * \param first on return, the offset in m_ranking of the first candidate of
+   *              each traffic class
+   * \param last on return, the offset in m_ranking past the last candidate of
+   *             each traffic class
+   */
+  void SortByTrafficClass (std::size_t (&first)[TC_UNCLASSIFIED + 1],
+                           std::size_t (&last)[TC_UNCLASSIFIED + 1]);
+  /**
+   * \return the sum of the capacities of the storage used to collect and rank
+   *         the candidates and to assign them RUs
+   */
+  std::size_t GetScratchCapacity (void) const;
+  /**
+   * Increment the counter of scratch allocations if the storage used to
+   * collect and rank the candidates grew since the last check.
+   */
+  void CheckScratchCapacity (void);
+  /**
+   * Allocate RUs to the (ranked) candidates in the given range, in order, until
+   * either all the candidates are assigned an RU, the total number of assigned
+   * RUs reaches the given maximum or the channel is full. If no RU of the
+   * requested type is available, an RU of a smaller type is allocated. The RUs
+   * are appended to m_ruAssigned, while candidates are not moved.
+   *
+   * \param first the beginning of the range of ranked candidates
+   * \param last the end of the range of ranked candidates
+   * \param firstRuType the type of the RU to assign to the first candidate
+   * \param ruType the type of the RUs to assign to the other candidates
+   * \param maxRus the maximum total number of RUs that can be assigned
+   * \return the number of candidates (from the first one) that are assigned an RU
+   */
+  std::size_t AllocateRus (RankIt first, RankIt last, HeRu::RuType firstRuType,
+                           HeRu::RuType ruType, std::size_t maxRus);
+  /**
+   * Compute the number of bytes that each of the first candidates in m_ranking
+   * can receive in an RU of each type, i.e., the bytes that can be transmitted
+   * in the RU (at the MCS used for single user frames) within the maximum
+   * duration of the DL MU PPDU, capped by the backlog of the candidate. With
+   * proportional fair scheduling, the bytes are divided by the average
+   * throughput of the candidate, while with earliest deadline first scheduling
+   * they are increased for the candidates whose head-of-line frame is about to
+   * expire. Results are stored in m_ruValues, by rank.
+   *
+   * \param bandwidth the channel bandwidth in MHz
+   * \param nCandidates the number of candidates
+   */
+  void ComputeRuValues (uint16_t bandwidth, std::size_t nCandidates);
+  /**
+   * \param candidate the index of the candidate in m_candidates
+   * \param ruType the type of the RU assigned to the candidate
+   * \return the number of bytes that can be transmitted in the RU within the
+   *         maximum duration of the DL MU PPDU, capped by the backlog of the candidate
+   */
+  uint64_t GetDeliverableBytes (uint16_t candidate, HeRu::RuType ruType) const;
+  /**
+   * Get the mode and the number of spatial streams used to transmit single user
+   * frames to the given station. They are returned from the cache, if valid, and
+   * otherwise obtained from MacLow::GetDataTxVector. In the latter case, the
+   * given MPDU is passed to MacLow::GetDataTxVector if not null; otherwise, a
+   * copy of m_mpdu addressed to the station is passed (the copy is reused as
+   * long as m_mpdu does not change).
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   * \param mpdu an MPDU addressed to the station, if available
+   * \return the mode and NSS used to transmit single user frames to the station
+   */
+  const SuTxInfo& GetSuTxInfo (uint16_t aid, Mac48Address address, Ptr<const WifiMacQueueItem> mpdu);
+  /**
+   * Assign to the candidate stations in m_ranking the RUs that maximize the
+   * bytes delivered in the DL MU PPDU, given the backlog and the MCS of each
+   * candidate. On success, m_ranking is reordered so that the i-th candidate
+   * is the one assigned the i-th RU in m_ruAssigned.
    *
    * \param bandwidth the channel bandwidth in MHz
-   * \param nStations the number of candidate stations. On return, it is set to
-   *                  the number of stations that are assigned an RU
-   * \return the RU type
+   * \param nStations the maximum number of stations that can be assigned an RU.
+   *                  On return, it is set to the number of assigned RUs
+   * \return false if no solution was found within the solver budget
+   */
+  bool SolveRuPacking (uint16_t bandwidth, std::size_t& nStations);
+  /**
+   * Assign to the candidate stations in m_ranking the RUs of the layout of
+   * the (20 or 40 MHz) channel that maximizes the bytes delivered in the DL MU
+   * PPDU. Each layout is scored by the best assignment of its RUs to the
+   * candidates, computed by ScoreRuLayout. On return, m_ranking is reordered
+   * so that the i-th candidate is the one assigned the i-th RU in m_ruAssigned.
+   *
+   * \param bandwidth the channel bandwidth in MHz (20 or 40)
+   * \param nStations the maximum number of stations that can be assigned an RU.
+   *                  On return, it is set to the number of assigned RUs
+   */
+  void SelectRuLayout (uint16_t bandwidth, std::size_t& nStations);
+  /**
+   * Compute the maximum number of bytes (weighted as in m_ruValues) that the
+   * RUs of the given layout can deliver to the first candidates, each of which
+   * is assigned at most one RU. The assignment is computed exactly by dynamic
+   * programming over the number of RUs of each type assigned so far.
+   *
+   * \param layout the number of RUs of each type (see HeRuTonePlan::RU_LAYOUTS_20MHZ)
+   * \param nCandidates the number of candidates (the first ones in m_ranking)
+   * \param assign whether to store in m_candidateOrder the RU type assigned
+   *               to each candidate (N_LAYOUT_RU_TYPES if none)
+   * \return the maximum number of bytes delivered
    */
-  std::vector<std::pair<HeRu::RuType,size_t>> GetNumberAndTypeOfRus (uint16_t bandwidth, std::size_t& nStations,std::list<std::pair<Mac48Address, DlPerStaInfo>> m_staInfo) ;
+  uint64_t ScoreRuLayout (const uint8_t* layout, std::size_t nCandidates, bool assign);
 
   /**
-   * Compute the TX vector and the TX params for a DL MU transmission assuming
-   * the given list of receiver stations, the given RU type and the given type
-   * of acknowledgment sequence.
+   * Compute the TX vector and the TX params for a DL MU transmission to the
+   * candidates in m_ranking, assuming the given RUs and the given type of
+   * acknowledgment sequence. The i-th ranked candidate is assigned the i-th RU.
    *
-   * \param staList the list of receiver stations for the DL MU transmission
-   * \param ruType the RU type
+   * \param ruAssigned the RUs assigned to the receiver stations
    * \param dlMuAckSequence the ack sequence type
    */
-  void InitTxVectorAndParams (std::map<Mac48Address, DlPerStaInfo> staList,
-                              std::vector<std::pair<HeRu::RuType,size_t>> ruType, DlMuAckSequenceType dlMuAckSequence);
+  void InitTxVectorAndParams (const std::vector<HeRu::RuSpec>& ruAssigned, DlMuAckSequenceType dlMuAckSequence);
+  /**
+   * Get the entry of the ack overhead cache matching the TX vector and the TX
+   * params computed by the last call to InitTxVectorAndParams. The signature
+   * of the entry is completed with the parameters of the PHY and the mode
+   * used to transmit the MU-BAR.
+   *
+   * \return the entry of the ack overhead cache
+   */
+  AckOverheadCache::Entry& LookupDlAckOverhead (void);
+  /**
+   * Get the UL length of the HE TB PPDUs carrying the Block Acks solicited by
+   * the given Trigger Frame, which is computed by MacLow and stored in the given
+   * entry of the ack overhead cache if not available.
+   *
+   * \param entry the entry of the ack overhead cache
+   * \param trigger the Trigger Frame soliciting the Block Acks
+   * \return the UL length of the HE TB PPDUs carrying the Block Acks
+   */
+  uint16_t GetDlAckUlLength (AckOverheadCache::Entry& entry, const CtrlTriggerHeader& trigger);
+  /**
+   * Get the duration of the response to the DL MU PPDU described by the TX
+   * vector and the TX params computed by the last call to InitTxVectorAndParams.
+   * The duration is looked up in the ack overhead cache if the ack sequence
+   * solicits Block Acks through a Trigger Frame.
+   *
+   * \return the duration of the response to the DL MU PPDU
+   */
+  Time GetDlResponseDuration (void);
+  /**
+   * Select the ack sequence that maximizes the goodput of the DL MU PPDU
+   * serving the first ranked candidates in the given RUs. For each ack sequence,
+   * the time available for data frames is the remaining TXOP (if any) minus the
+   * response duration, capped at m_maxDlDuration and at the maximum PPDU
+   * duration. The goodput is the number of bytes the candidates can receive in
+   * their RUs within such time divided by the duration of the longest A-MPDU
+   * plus the response duration.
+   * Ack sequences leaving no room for the head-of-line frame of a candidate are
+   * discarded. m_maxDlDuration is set to the time available for data frames
+   * with the selected ack sequence.
+   *
+   * \param ruAssigned the RUs assigned to the receiver stations
+   * \param nStations the number of receiver stations
+   * \return the selected ack sequence, or m_dlMuAckSequence if none fits
+   */
+  DlMuAckSequenceType SelectDlAckSequence (const std::vector<HeRu::RuSpec>& ruAssigned, std::size_t nStations);
+  /**
+   * Add the backlogged stations, in round robin order starting from m_startStation,
+   * to the candidates for the next DL MU PPDU. A station is added if the AP has
+   * a frame to send to it that meets the size and time limits. With proportional
+   * fair and earliest deadline first scheduling, the candidates are selected by
+   * AddDlCandidatesByMetric.
+   *
+   * \param currTid the TID of the frame that triggered the scheduling decision
+   * \param primaryAc the primary AC
+   * \param eligibleTids bitmap of the TIDs that can be served
+   * \param guessRus the RUs the candidates are guessed to be assigned
+   * \param txopLimit the time available for the DL MU PPDU (0 if no TXOP)
+   * \param useSlot whether only the stations of the next PPDU of the TXOP
+   *                plan can be added
+   * \return the AID of the station to start with next time (0 if none)
+   */
+  uint16_t AddDlCandidates (uint8_t currTid, AcIndex primaryAc, uint8_t eligibleTids,
+                            const std::vector<HeRu::RuSpec>& guessRus, Time txopLimit, bool useSlot);
+  /**
+   * Add the backlogged stations with the highest metric of the scheduling
+   * policy to the candidates for the next DL MU PPDU, best first. The ring of
+   * backlogged stations is walked once and the metric of each station is
+   * computed from per-AID state (and, for earliest deadline first, from the
+   * head of its queue), keeping the best m_nStations stations in a bounded
+   * heap. Only such stations are checked, and a station is added if its frame
+   * meets the size and time limits.
+   *
+   * \param currTid the TID of the frame that triggered the scheduling decision
+   * \param primaryAc the primary AC
+   * \param eligibleTids bitmap of the TIDs that can be served
+   * \param guessRus the RUs the candidates are guessed to be assigned
+   * \param txopLimit the time available for the DL MU PPDU (0 if no TXOP)
+   * \param useSlot whether only the stations of the next PPDU of the TXOP
+   *                plan can be added
+   * \return the AID of the station to start with next time (0 if none)
+   */
+  uint16_t AddDlCandidatesByMetric (uint8_t currTid, AcIndex primaryAc, uint8_t eligibleTids,
+                                    const std::vector<HeRu::RuSpec>& guessRus, Time txopLimit,
+                                    bool useSlot);
+  /**
+   * Compute the metric of the given station for the scheduling policy (the
+   * higher, the sooner the station is served). For earliest deadline first,
+   * the metric is the opposite of the deadline of the head-of-line frame of
+   * the TID that would be served, which is also stored in m_holDeadline.
+   *
+   * \param aid the AID of a backlogged station
+   * \param backlog bitmap of the backlogged TIDs that can be served
+   * \param currTid the TID of the frame that triggered the scheduling decision
+   * \param metric on return, the metric of the station
+   * \return false if no frame can be sent to the station
+   */
+  bool GetStationMetric (uint16_t aid, uint8_t backlog, uint8_t currTid, double& metric);
+  /**
+   * Add the given station to the candidates for the next DL MU PPDU if the
+   * AP has a frame to send to it, for one of the given TIDs with a BA
+   * agreement, that meets the size and time limits.
+   *
+   * \param aid the AID of the station
+   * \param backlog bitmap of the backlogged TIDs that can be served
+   * \param currTid the TID of the frame that triggered the scheduling decision
+   * \param ru the RU the station is guessed to be assigned
+   * \param txopLimit the time available for the DL MU PPDU (0 if no TXOP)
+   * \return the head-of-line frame of the station if it was added, a null
+   *         pointer otherwise
+   */
+  Ptr<const WifiMacQueueItem> AddDlCandidate (uint16_t aid, uint8_t backlog, uint8_t currTid,
+                                              const HeRu::RuSpec& ru, Time txopLimit);
+
+  /// A backlogged station selected by its scheduling metric
+  struct StationMetric
+  {
+    double metric;   //!< the metric of the scheduling policy
+    uint16_t order;  //!< position of the station in the round robin order
+    uint16_t aid;    //!< AID of the station
+  };
+  /// A backlogged station considered by the TXOP plan
+  struct TxopPlanEntry
+  {
+    Time demand;     //!< time needed to send the queued frames of the station
+    uint16_t order;  //!< position of the station in the round robin order
+    uint16_t aid;    //!< AID of the station
+  };
+  /**
+   * Plan the DL MU PPDUs of the remaining TXOP. The time needed by each
+   * backlogged station to send its queued frames in an RU of the guessed size
+   * is computed in round robin order, then the plan is built by BuildTxopPlan.
+   *
+   * \param eligibleTids bitmap of the TIDs that can be served
+   * \param guessRus the RUs the stations are guessed to be assigned
+   * \param overhead the time between two DL MU PPDUs (response and SIFS)
+   */
+  void PlanTxop (uint8_t eligibleTids, const std::vector<HeRu::RuSpec>& guessRus, Time overhead);
+  /**
+   * Build the TXOP plan from the stations in m_txopPlanEntries. The stations
+   * are sorted by decreasing demand, and each group of consecutive stations
+   * is served by a PPDU lasting as long as required by the first station of
+   * the group. A station starting a new PPDU is skipped if the PPDU does not
+   * fit in the remaining TXOP, and the last PPDU is shortened to fit.
+   *
+   * \param groupSize the number of stations served by a PPDU
+   * \param overhead the time between two DL MU PPDUs (response and SIFS)
+   * \param nextAid the station to start with after the plan if none is skipped
+   */
+  void BuildTxopPlan (std::size_t groupSize, Time overhead, uint16_t nextAid);
+  /**
+   * Mark the stations served by the next PPDU of the TXOP plan.
+   *
+   * \param member true to mark the stations, false to unmark them
+   */
+  void SetTxopSlotMembers (bool member);
+
+  /// A DL MU PPDU of the TXOP plan
+  struct TxopSlot
+  {
+    std::size_t first;      //!< index in m_txopPlanAids of the first station served
+    std::size_t nStations;  //!< number of stations served
+    Time duration;          //!< planned duration of the PPDU
+  };
+
+  /// The state read and written by the selection of a DL MU PPDU
+  struct DlState
+  {
+    CandidateStore candidates;              //!< candidate stations
+    std::vector<uint16_t> ranking;          //!< indices of the candidates, ranked
+    DlSchedulingPlan dlPlan;                //!< plan of the DL MU PPDU
+    WifiTxVector txVector;                  //!< TX vector
+    MacLowTransmissionParameters txParams;  //!< TX params
+    DlMuAckSequenceType dlMuAckSequence;    //!< DL MU ack sequence type
+    Time maxDlDuration;                     //!< maximum duration of the DL MU PPDU
+    Time dlTxopRemaining;                   //!< remaining TXOP (0 if none)
+    uint16_t startStation;                  //!< AID of the station to start with
+    Time txopPlanStart;                     //!< start time of the TXOP the plan refers to
+    std::vector<uint16_t> txopPlanAids;     //!< stations of the TXOP plan
+    std::vector<Time> txopPlanDemand;       //!< time needed by the stations of the TXOP plan
+    std::vector<TxopSlot> txopSlots;        //!< DL MU PPDUs of the TXOP plan
+    std::size_t nextTxopSlot;               //!< index of the next PPDU of the TXOP plan
+    uint16_t txopPlanNextStart;             //!< station to start with after the TXOP plan
+  };
+
+  /**
+   * Select the format of the next transmission, given that an UL OFDMA
+   * transmission was not selected, and build the plan of the DL MU PPDU.
+   *
+   * \param mpdu the MPDU that triggered the scheduling decision
+   * \param newTxop whether to assume that the TXOP (if any) has just started
+   * \return the format of the next transmission
+   */
+  OfdmaTxFormat SelectDlTxFormat (Ptr<const WifiMacQueueItem> mpdu, bool newTxop);
+  /**
+   * Plan in advance the DL MU PPDU to send at the next channel access, assuming
+   * that it is triggered by an MPDU of the same TID as m_mpdu and that a new
+   * TXOP (if any) is started. The current state is left unchanged.
+   */
+  void Lookahead (void);
+  /**
+   * \param mpdu the MPDU that triggered the scheduling decision
+   * \return whether the DL MU PPDU planned in advance can be sent now, i.e.,
+   *         the state it was planned on did not change, the given MPDU has
+   *         the assumed TID and the TXOP (if any) has just started
+   */
+  bool IsLookaheadValid (Ptr<const WifiMacQueueItem> mpdu) const;
+  /**
+   * Mark (or unmark) the candidates of the DL MU PPDU planned in advance. A
+   * change of the backlogged TIDs of such stations or a failed transmission
+   * to them invalidates the plan.
+   *
+   * \param member whether the candidates are marked or unmarked
+   */
+  void SetLookaheadMembers (bool member);
+  /**
+   * Copy the fields of the given state that are read by the selection of a DL
+   * MU PPDU, i.e., the station to start with and the TXOP plan.
+   *
+   * \param state the state to copy the fields from
+   */
+  void LoadDlInputs (const DlState& state);
+  /**
+   * Swap the state of the selection of DL MU PPDUs with the given object.
+   *
+   * \param state the object to swap the state with
+   */
+  void SwapDlState (DlState& state);
+
+  /// The overhead of UL OFDMA exchanges given the number of solicited stations and of RA-RUs
+  struct UlOverheadModel
+  {
+    WifiMode tfMode;                    //!< the mode used to transmit the Trigger Frame
+    UlMuAckSequenceType ackSequence;    //!< the UL MU ack sequence type
+    uint16_t channelWidth;              //!< the channel width in MHz
+    uint16_t guardInterval;             //!< the guard interval in nanoseconds
+    std::size_t nRaRuValues;            //!< the number of possible values of the number of RA-RUs
+    std::vector<Time> overhead;         //!< the overhead, indexed by the number of stations times
+                                        //!< nRaRuValues plus the number of RA-RUs (negative if unknown)
+  };
+
+  /// A station solicited to transmit in an HE TB PPDU
+  struct UlStation
+  {
+    uint16_t aid;            //!< the AID of the station
+    Mac48Address address;    //!< the MAC address of the station
+    uint32_t bufferSize;     //!< the buffered bytes reported by the station (0xffffffff if not limited)
+    WifiMode mode;           //!< the mode used by the station
+    uint8_t nss;             //!< the number of spatial streams used by the station
+    HeRu::RuSpec ru;         //!< the RU assigned to the station
+  };
+
+  /**
+   * Notify that the PHY received an MPDU. The QoS frames sent to the AP by an
+   * associated station are accounted for by the buffer status estimator.
+   *
+   * \param packet the MPDU (including the MAC header and the FCS)
+   * \param channelFreqMhz the operating frequency in MHz
+   * \param txVector the TX vector of the PPDU carrying the MPDU
+   * \param aMpdu information about the A-MPDU, if any
+   * \param signalNoise the signal and noise power
+   * \param staId the STA-ID of the receiver
+   */
+  void NotifyMonitorSnifferRx (Ptr<const Packet> packet, uint16_t channelFreqMhz, WifiTxVector txVector,
+                               MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId);
+  /**
+   * Pass the buffer status reported by the frames just received from the given
+   * station to the buffer status estimator. This is scheduled by
+   * NotifyMonitorSnifferRx, as the AP reads the buffer status after the PHY
+   * notifies the reception.
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   */
+  void ReadBufferStatus (uint16_t aid, Mac48Address address);
+  /**
+   * Record whether the buffer status of the given station is not limited.
+   *
+   * \param aid the AID of the station
+   * \param unlimited whether the buffer status of the station is not limited
+   */
+  void SetUlUnlimited (uint16_t aid, bool unlimited);
+  /**
+   * Get the number of bytes the given station is expected to transmit if
+   * solicited now. The buffer status estimator accounts for the age of the
+   * last report and for the arrival rate of the station. If the buffer status
+   * is unknown, the value of the UlPsduSize attribute is returned; if it is not
+   * limited, 0xffffffff is returned.
+   *
+   * \param aid the AID of the station
+   * \param address the MAC address of the station
+   * \return the number of bytes buffered by the station
+   */
+  uint32_t GetUlBufferSize (uint16_t aid, Mac48Address address) const;
+  /**
+   * Get the time taken by an UL OFDMA exchange in addition to the HE TB PPDU,
+   * i.e., the time to transmit the Basic Trigger Frame and the response time
+   * after the HE TB PPDU. Such time only depends on the number of solicited
+   * stations and of RA-RUs once the mode used for the Trigger Frame, the UL MU
+   * ack sequence, the channel width and the guard interval are given, hence it
+   * is computed once per number of stations and of RA-RUs and recomputed if any
+   * of them changes.
+   *
+   * \param trigger the Basic Trigger Frame soliciting the stations in m_ulStations,
+   *                including the User Info fields for the RA-RUs in m_raRus
+   * \param params the TX params of the UL OFDMA exchange
+   * \return the overhead of the UL OFDMA exchange
+   */
+  Time GetUlExchangeOverhead (CtrlTriggerHeader& trigger, const MacLowTransmissionParameters& params);
+  /**
+   * \return the bytes queued by the AP for the backlogged stations
+   */
+  uint64_t GetDlBacklog (void) const;
+  /**
+   * Get the bytes the associated stations are estimated to have buffered,
+   * including the TCP acknowledgments they are expected to send in response
+   * to the bulk flows they received since they last reported their buffer status.
+   * The sums over the stations are kept up to date as reports are read, hence
+   * the UL backlog is computed in constant time.
+   *
+   * \return the estimated UL backlog
+   */
+  uint64_t GetUlBacklog (void) const;
+  /**
+   * \return whether an UL OFDMA transmission should be tried, i.e., whether
+   *         UL transmissions have recently been given a smaller share of TXOPs
+   *         than the share of the UL backlog (weighted by the trigger efficiency)
+   *         in the total backlog
+   */
+  bool IsUlPreferred (void);
+  /**
+   * Update the trigger efficiency based on the responses to the last Basic
+   * Trigger Frame.
+   */
+  void CompleteUlExchange (void);
+  /**
+   * Assign an RU to each station in m_ulStations based on its buffer status and
+   * its mode, and build m_ulTxVector. Stations start with a 26-tone RU and the
+   * RU of the station needing the longest time to transmit its buffered bytes
+   * is repeatedly doubled, as long as all the RUs fit in the channel. The given
+   * number of 26-tone RUs is reserved for random access (m_raRus).
+   *
+   * \param bandwidth the channel bandwidth in MHz
+   * \param nRaRus the number of RA-RUs
+   */
+  void AllocateUlRus (uint16_t bandwidth, std::size_t nRaRus);
+  /**
+   * Get the duration of an HE TB PPDU carrying the given number of bytes sent
+   * by the given station in the RU it is assigned by m_ulTxVector or, if the
+   * AID is 0, sent in an RA-RU.
+   *
+   * \param size the PSDU size in bytes
+   * \param aid the AID of the station (0 for an RA-RU)
+   * \return the duration of the HE TB PPDU
+   */
+  Time GetUlTxDuration (uint32_t size, uint16_t aid) const;
+  /**
+   * Notify that an MPDU sent by the given station in an HE TB PPDU was received
+   * while the outcome of the RA-RUs of the last Basic Trigger Frame is pending.
+   *
+   * \param address the MAC address of the station
+   * \param aid the AID of the station
+   * \param txVector the TX vector of the HE TB PPDU
+   */
+  void NotifyRaRuRx (Mac48Address address, uint16_t aid, const WifiTxVector& txVector);
+  /**
+   * Update the counters and fire the trace sources reporting the outcome of
+   * the RA-RUs of the last Basic Trigger Frame.
+   */
+  void CompleteRaRus (void);
+  /**
+   * Place the RUs of the types currently assigned to the stations in m_ulStations
+   * and the RA-RUs.
+   *
+   * \param bandwidth the channel bandwidth in MHz
+   * \return true if all the RUs fit in the channel
+   */
+  bool PlaceUlRus (uint16_t bandwidth);
 
   /**
    * Get a MU-BAR Trigger Frame built from the TX vector used for the DL MU PPDU
@@ -107,22 +1095,119 @@ private:
    *
    * \param dlMuTxVector the TX vector used for the DL MU PPDU
    * \param maxMcs the maximum MCS to use for the responses to the Trigger Frame
+   * \return the MU-BAR Trigger Frame
    */
-  char* decToHexa(int n) ;
   CtrlTriggerHeader GetTriggerFrameHeader (WifiTxVector dlMuTxVector, uint8_t maxMcs);
-void merge(std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>>& v, int p, int q, int r);
-void merge_sort(std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>>& v, int p, int r) ;
+
   uint8_t m_nStations;                                         //!< Number of stations/slots to fill
   uint16_t m_startStation;                                     //!< AID of the station to start with
-  std::list<std::pair<Mac48Address, DlPerStaInfo>> m_staInfo;  //!< Info for the stations the AP has frames to send to
-  std::unordered_map<std::string,HeRu::RuType>  table = { {"RU_26_TONE",HeRu::RuType::RU_26_TONE}, {"RU_52_TONE",HeRu::RuType::RU_52_TONE}, {"RU_106_TONE",HeRu::RuType::RU_106_TONE}};
-  std::vector<Mac48Address> bulksend1={Mac48Address("0:0:0:0:0:1"),Mac48Address("0:0:0:0:0:2"),Mac48Address("0:0:0:0:0:3"),Mac48Address("0:0:0:0:0:4"),Mac48Address("0:0:0:0:0:5"),Mac48Address("0:0:0:0:0:6"),Mac48Address("0:0:0:0:0:7"),Mac48Address("0:0:0:0:0:8"),Mac48Address("0:0:0:0:0:9"),Mac48Address("0:0:0:0:0:A")};
-  std::vector<Mac48Address> onoff1={Mac48Address("0:0:0:0:0:B"),Mac48Address("0:0:0:0:0:C"),Mac48Address("0:0:0:0:0:D"),Mac48Address("0:0:0:0:0:E"),Mac48Address("0:0:0:0:0:F")};
-  std::vector<Mac48Address> http1={Mac48Address("0:0:0:0:0:10"),Mac48Address("0:0:0:0:0:11"),Mac48Address("0:0:0:0:0:12"),Mac48Address("0:0:0:0:0:13"),Mac48Address("0:0:0:0:0:14"),Mac48Address("0:0:0:0:0:15"),Mac48Address("0:0:0:0:0:16"),Mac48Address("0:0:0:0:0:17"),Mac48Address("0:0:0:0:0:18"),Mac48Address("0:0:0:0:0:19"),Mac48Address("0:0:0:0:0:1A"),Mac48Address("0:0:0:0:0:1B"),Mac48Address("0:0:0:0:0:1C"),Mac48Address("0:0:0:0:0:1D"),Mac48Address("0:0:0:0:0:1E"),Mac48Address("0:0:0:0:0:1F"),Mac48Address("0:0:0:0:0:20")};
-  // std::vector<HeRu::RuType> ruAssigned;
-  // std::vector<size_t>ruIndexValues;
-  std::vector<std::tuple<Mac48Address,uint32_t ,DlPerStaInfo>> m_dataInfo;
+  std::vector<TrafficClass> m_trafficClass;                    //!< traffic class of each station, indexed by AID
+  std::string m_trafficClassMap;                               //!< traffic class map set through the attribute
+  CandidateStore m_candidates;                                 //!< candidate stations
+  std::vector<uint16_t> m_ranking;                             //!< indices of the candidates, ranked
+  std::vector<HeRu::RuSpec> m_ruAssigned;                      //!< scratch storage for the RUs assigned to candidates
+  RuAllocator m_ruAllocator;                                   //!< allocator placing RUs of different sizes
+  RuAllocationMode m_ruAllocationMode;                         //!< algorithm used to assign RUs
+  RuPackingSolver m_ruPackingSolver;                           //!< solver used by the optimal RU allocation
+  uint64_t m_solverBudget;                                     //!< maximum number of solver state updates per PPDU
+  std::vector<uint64_t> m_ruValues;                            //!< bytes each candidate can receive in each RU type
+  std::vector<uint16_t> m_rankingScratch;                      //!< scratch storage to reorder candidates
+  std::vector<std::size_t> m_candidateOrder;                   //!< scratch storage to rank candidates by index
+  std::vector<uint8_t> m_layoutChoice;                         //!< RU type assigned to each candidate in each state of ScoreRuLayout
+  std::vector<StationMetric> m_topStations;                    //!< heap of the stations with the highest metric
+  Time m_maxDlDuration;                                        //!< maximum duration of the next DL MU PPDU
+  TxDurationCache m_txDurationCache;                           //!< TX durations of candidate frames
+  DlSchedulingPlan m_dlPlan;                                   //!< plan of the next DL MU PPDU
+  uint64_t m_nScratchAllocations;                              //!< number of times the scratch storage grew
+  std::size_t m_scratchCapacity;                               //!< capacity of the scratch storage at the last check
+  uint64_t m_nDecisionAllocations;                             //!< heap allocations made by scheduling decisions
+  uint64_t m_nDecisions;                                       //!< number of scheduling decisions
+  Ptr<WifiMacQueueItem> m_suMpdu;                              //!< copy of m_mpdu used to get SU TX vectors
+  Ptr<const WifiMacQueueItem> m_suMpduSource;                  //!< the MPDU m_suMpdu is a copy of
+  std::vector<uint8_t> m_backlog;                              //!< bitmap of the backlogged TIDs, indexed by AID
+  std::vector<uint32_t> m_nQueuedMpdus;                        //!< number of queued MPDUs, indexed by AID * 8 + TID
+  std::vector<uint32_t> m_nQueuedBytes;                        //!< bytes of the queued MSDUs, indexed by AID * 8 + TID
+  SchedulingPolicy m_schedulingPolicy;                         //!< policy used to select the stations to serve
+  Time m_pfTimeConstant;                                       //!< time constant of the average throughput
+  std::vector<double> m_avgThroughput;                         //!< average throughput (bytes/s), indexed by AID
+  std::vector<Time> m_avgThroughputUpdate;                     //!< last update of the average throughput, indexed by AID
+  std::vector<Time> m_holDeadline;                             //!< expiry time of the head-of-line frame, indexed by AID
+  double m_deadlineWeight;                                     //!< weight of the urgency of a station in RU values
+  std::map<Mac48Address, uint16_t> m_aidMap;                   //!< AID of the associated stations
+  std::vector<Mac48Address> m_staAddress;                      //!< MAC address of the associated stations, indexed by AID
+  std::vector<uint16_t> m_ringNext;                            //!< next backlogged station (0 is the sentinel), indexed by AID
+  std::vector<uint16_t> m_ringPrev;                            //!< previous backlogged station (0 is the sentinel), indexed by AID
+  std::vector<uint64_t> m_activeStations;                      //!< bitmap of the backlogged stations, indexed by AID
+  std::vector<uint8_t> m_baTids;                               //!< bitmap of the TIDs with a BA agreement, indexed by AID
+  std::vector<BlockAckReqType> m_barType;                      //!< BAR type, indexed by AID * 8 + TID
+  std::vector<BlockAckType> m_baType;                          //!< BA type, indexed by AID * 8 + TID
+  std::vector<SuTxInfo> m_suTxInfo;                            //!< cached SU TX info, indexed by AID
+  uint32_t m_suTxInfoEpoch;                                    //!< epoch of the valid SU TX info entries
+  Time m_suTxInfoLifetime;                                     //!< lifetime of the SU TX info entries
+  uint64_t m_nSuTxInfoHits;                                    //!< number of SU TX info cache hits
+  uint64_t m_nSuTxInfoMisses;                                  //!< number of SU TX info cache misses
+  BufferStatusEstimator m_bsrEstimator;                        //!< estimator of the buffer status of the stations
+  std::vector<Time> m_bsrReportTime;                           //!< time of the last report not yet read (0 if none), indexed by AID
+  std::vector<uint8_t> m_ulUnlimited;                          //!< 1 if the buffer status is not limited, indexed by AID
+  std::size_t m_nUlUnlimited;                                  //!< number of stations whose buffer status is not limited
+  Time m_bsrDecayTime;                                         //!< time constant of the decay of reported buffer status
+  Time m_bsrRateTimeConstant;                                  //!< time constant of the arrival rate average
+  bool m_backlogTracesConnected;                               //!< whether the backlog index traces are connected
   WifiTxVector m_txVector;                                     //!< TX vector
+  std::vector<UlStation> m_ulStations;                         //!< stations solicited by the next Basic Trigger Frame
+  WifiTxVector m_ulTxVector;                                   //!< TX vector used to build the next Basic Trigger Frame
+  UlOverheadModel m_ulOverhead;                                //!< overhead of UL OFDMA exchanges
+  WifiMacHeader m_triggerHdr;                                  //!< MAC header of Basic Trigger Frames
+  Ptr<Packet> m_triggerPayload;                                //!< empty packet used to query the Trigger Frame TX vector
+  uint8_t m_nRaRus;                                            //!< number of RA-RUs when stations contend
+  std::vector<HeRu::RuSpec> m_raRus;                           //!< RA-RUs of the next Basic Trigger Frame
+  WifiTxVector m_raTxVector;                                   //!< TX vector of frames sent in an RA-RU
+  bool m_raRuPending;                                          //!< whether the outcome of the last RA-RUs is pending
+  std::vector<Mac48Address> m_raRuStation;                     //!< last station received in each RA-RU
+  std::vector<uint8_t> m_raRuNStations;                        //!< number of stations received in each RA-RU
+  std::vector<uint64_t> m_nRaRuSuccesses;                      //!< number of successes of each RA-RU
+  std::vector<uint64_t> m_nRaRuCollisions;                     //!< number of collisions of each RA-RU
+  TracedCallback<uint8_t, Mac48Address> m_raRuSuccessTrace;    //!< RA-RU success trace source
+  TracedCallback<uint8_t, uint8_t> m_raRuCollisionTrace;       //!< RA-RU collision trace source
+  TxFormatSelection m_txFormatSelection;                       //!< method used to select the TX format
+  bool m_singleStationSu;                                      //!< whether SU PPDUs are sent if a single station is backlogged
+  double m_tcpAckRatio;                                        //!< ratio of TCP ack bytes to bulk DL bytes
+  std::vector<double> m_predictedAckBytes;                     //!< TCP ack bytes expected from each station, indexed by AID
+  double m_predictedAckTotal;                                  //!< TCP ack bytes expected from all the stations
+  std::vector<uint32_t> m_bulkMpduSize;                        //!< size of the last MPDU dequeued for a bulk-send station, indexed by AID
+  std::vector<uint8_t> m_ulSolicited;                          //!< 1 if solicited, 2 if also responded, indexed by AID
+  bool m_ulPending;                                            //!< whether the responses to the last Basic Trigger are pending
+  std::size_t m_nUlResponded;                                  //!< number of solicited stations that responded
+  double m_triggerEfficiency;                                  //!< average fraction of solicited stations that responded
+  double m_ulServedShare;                                      //!< average share of TXOPs used for UL transmissions
+  std::vector<uint32_t> m_dlAckKey;                            //!< signature of the DL ack sequence set by InitTxVectorAndParams
+  AckOverheadCache m_dlAckOverhead;                            //!< overhead of DL ack sequences
+  DlAckSequenceSelection m_dlAckSequenceSelection;             //!< method used to select the DL ack sequence
+  Time m_dlTxopRemaining;                                      //!< remaining TXOP when the DL MU PPDU is built (0 if none)
+  std::vector<uint64_t> m_nDlAckSequences;                     //!< number of DL MU PPDUs per ack sequence
+  bool m_txopPlanning;                                         //!< whether the DL MU PPDUs of a TXOP are planned
+  Time m_txopPlanStart;                                        //!< start time of the TXOP the plan refers to
+  std::vector<uint16_t> m_txopPlanAids;                        //!< stations of the TXOP plan, grouped by PPDU
+  std::vector<Time> m_txopPlanDemand;                          //!< time needed by the stations of the TXOP plan
+  std::vector<TxopPlanEntry> m_txopPlanEntries;                //!< stations considered by the TXOP plan
+  std::vector<TxopSlot> m_txopSlots;                           //!< DL MU PPDUs of the TXOP plan
+  std::size_t m_nextTxopSlot;                                  //!< index of the next PPDU of the TXOP plan
+  uint16_t m_txopPlanNextStart;                                //!< station to start with after the TXOP plan
+  std::vector<uint8_t> m_txopSlotMember;                       //!< 1 if served by the next planned PPDU, indexed by AID
+  uint64_t m_nTxopPlans;                                       //!< number of TXOP plans
+  uint64_t m_nPlannedPpdus;                                    //!< number of planned DL MU PPDUs sent
+  bool m_lookahead;                                            //!< whether DL MU PPDUs are planned in advance
+  uint64_t m_dlStateVersion;                                   //!< incremented when a change invalidates the plan made in advance
+  EventId m_lookaheadEvent;                                    //!< event planning the next DL MU PPDU
+  DlState m_lookaheadState;                                    //!< the state resulting from the plan made in advance
+  std::vector<uint8_t> m_lookaheadMember;                      //!< 1 if a candidate of the plan made in advance, indexed by AID
+  bool m_lookaheadValid;                                       //!< whether a plan made in advance is available
+  OfdmaTxFormat m_lookaheadFormat;                             //!< the format selected by the plan made in advance
+  uint8_t m_lookaheadTid;                                      //!< the TID assumed by the plan made in advance
+  uint64_t m_lookaheadVersion;                                 //!< m_dlStateVersion when the plan was made in advance
+  uint32_t m_lookaheadSuTxInfoEpoch;                           //!< m_suTxInfoEpoch when the plan was made in advance
+  uint64_t m_nLookaheadHits;                                   //!< number of plans made in advance that were committed
+  uint64_t m_nLookaheadMisses;                                 //!< number of plans made in advance that were discarded
   MacLowTransmissionParameters m_txParams;                     //!< TX params
   DlMuAckSequenceType m_dlMuAckSequence;                       //!< DL MU ack sequence type
   UlMuAckSequenceType m_ulMuAckSequence;                       //!< UL MU ack sequence type
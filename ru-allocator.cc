@@ -0,0 +1,170 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ru-allocator.h"
+#include "he-ru-tone-plan.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RuAllocator");
+
+RuAllocator::RuAllocator ()
+  : m_bandwidth (20),
+    m_occupied {0, 0}
+{
+}
+
+void
+RuAllocator::Reset (uint16_t bandwidth)
+{
+  NS_LOG_FUNCTION (this << bandwidth);
+  NS_ASSERT (bandwidth == 20 || bandwidth == 40 || bandwidth == 80 || bandwidth == 160);
+  m_bandwidth = bandwidth;
+  // slots that do not exist at the given bandwidth are marked as occupied
+  uint64_t segmentMask = (uint64_t (1) << HeRuTonePlan::SLOTS_PER_SEGMENT) - 1;
+  uint64_t validMask = (uint64_t (1) << HeRuTonePlan::GetNSlots (bandwidth == 160 ? 80 : bandwidth)) - 1;
+  m_occupied[0] = segmentMask & ~validMask;
+  m_occupied[1] = (bandwidth == 160 ? 0 : segmentMask);
+}
+
+uint16_t
+RuAllocator::GetBandwidth (void) const
+{
+  return m_bandwidth;
+}
+
+bool
+RuAllocator::IsFree (std::size_t segment, HeRu::RuType ruType, std::size_t index) const
+{
+  if (index == 0 || index > HeRuTonePlan::GetNRusPerSegment (m_bandwidth, ruType))
+    {
+      return false;
+    }
+  if (ruType == HeRu::RU_2x996_TONE)
+    {
+      return (m_occupied[0] == 0 && m_occupied[1] == 0);
+    }
+  return ((m_occupied[segment] & HeRuTonePlan::GetSlotMask (ruType, index)) == 0);
+}
+
+bool
+RuAllocator::IsFree (const HeRu::RuSpec& ru) const
+{
+  return IsFree (ru.primary80MHz ? 0 : 1, ru.ruType, ru.index);
+}
+
+std::size_t
+RuAllocator::GetLargestFreeAncestor (std::size_t segment, HeRu::RuType ruType, std::size_t index) const
+{
+  std::size_t nSlots = HeRuTonePlan::GetNSlots (ruType);
+  while (ruType != HeRu::RU_2x996_TONE)
+    {
+      HeRu::RuType parentType = HeRuTonePlan::GetParentType (ruType, index);
+      index = HeRuTonePlan::GetParentIndex (ruType, index);
+      ruType = parentType;
+      if (!IsFree (segment, ruType, index))
+        {
+          break;
+        }
+      nSlots = HeRuTonePlan::GetNSlots (ruType);
+    }
+  return nSlots;
+}
+
+bool
+RuAllocator::FindBestFit (HeRu::RuType ruType, std::size_t& segment, std::size_t& index) const
+{
+  std::size_t nRus = HeRuTonePlan::GetNRusPerSegment (m_bandwidth, ruType);
+  std::size_t nSegments = (ruType == HeRu::RU_2x996_TONE ? 1 : HeRuTonePlan::GetNSegments (m_bandwidth));
+  std::size_t bestAncestor = 0;
+
+  for (std::size_t s = 0; s < nSegments; s++)
+    {
+      for (std::size_t i = 1; i <= nRus; i++)
+        {
+          if (!IsFree (s, ruType, i))
+            {
+              continue;
+            }
+          std::size_t ancestor = GetLargestFreeAncestor (s, ruType, i);
+          if (bestAncestor == 0 || ancestor < bestAncestor)
+            {
+              bestAncestor = ancestor;
+              segment = s;
+              index = i;
+              if (ancestor == HeRuTonePlan::GetNSlots (ruType))
+                {
+                  // the RU fills a hole, no better choice is possible
+                  return true;
+                }
+            }
+        }
+    }
+  return (bestAncestor > 0);
+}
+
+bool
+RuAllocator::CanAllocate (HeRu::RuType ruType) const
+{
+  std::size_t segment, index;
+  return FindBestFit (ruType, segment, index);
+}
+
+bool
+RuAllocator::Allocate (HeRu::RuType ruType, HeRu::RuSpec& ru)
+{
+  NS_LOG_FUNCTION (this << ruType);
+
+  std::size_t segment, index;
+  if (!FindBestFit (ruType, segment, index))
+    {
+      NS_LOG_DEBUG ("No free RU of type " << ruType);
+      return false;
+    }
+
+  if (ruType == HeRu::RU_2x996_TONE)
+    {
+      m_occupied[0] = m_occupied[1] = (uint64_t (1) << HeRuTonePlan::SLOTS_PER_SEGMENT) - 1;
+    }
+  else
+    {
+      m_occupied[segment] |= HeRuTonePlan::GetSlotMask (ruType, index);
+    }
+  ru = {segment == 0, ruType, index};
+  NS_LOG_DEBUG ("Allocated " << ru);
+  return true;
+}
+
+std::size_t
+RuAllocator::GetNFreeSlots (void) const
+{
+  std::size_t nFree = 0;
+  for (std::size_t s = 0; s < 2; s++)
+    {
+      uint64_t free = ~m_occupied[s] & ((uint64_t (1) << HeRuTonePlan::SLOTS_PER_SEGMENT) - 1);
+      for (; free != 0; free &= free - 1)
+        {
+          nFree++;
+        }
+    }
+  return nFree;
+}
+
+} //namespace ns3
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RU_ALLOCATOR_H
+#define RU_ALLOCATOR_H
+
+#include "he-ru.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * RuAllocator places RUs of any size in an HE channel of 20, 40, 80 or 160 MHz.
+ * The channel is represented as a bitmask of 26-tone slots per 80 MHz segment
+ * (see HeRuTonePlan), so that the allocated RUs are guaranteed not to overlap
+ * and to have legal indices, including the center 26-tone RUs and the RUs of
+ * the secondary 80 MHz segment at 160 MHz.
+ *
+ * RUs are placed buddy-style: among the free RUs of the requested type, the
+ * allocator picks the one whose largest free ancestor in the RU hierarchy is
+ * the smallest, so that larger free RUs are only split when necessary.
+ */
+class RuAllocator
+{
+public:
+  RuAllocator ();
+
+  /**
+   * Mark all the RUs of a channel of the given bandwidth as free.
+   *
+   * \param bandwidth the channel bandwidth in MHz (20, 40, 80 or 160)
+   */
+  void Reset (uint16_t bandwidth);
+  /**
+   * \return the bandwidth of the channel
+   */
+  uint16_t GetBandwidth (void) const;
+  /**
+   * Allocate a free RU of the given type, if any.
+   *
+   * \param ruType the RU type
+   * \param ru the allocated RU, if the allocation succeeds
+   * \return true if an RU of the given type has been allocated
+   */
+  bool Allocate (HeRu::RuType ruType, HeRu::RuSpec& ru);
+  /**
+   * \param ruType the RU type
+   * \return true if an RU of the given type can be allocated
+   */
+  bool CanAllocate (HeRu::RuType ruType) const;
+  /**
+   * \param ru the RU
+   * \return true if the given RU is legal for the channel and none of its tones is allocated
+   */
+  bool IsFree (const HeRu::RuSpec& ru) const;
+  /**
+   * \return the number of free 26-tone slots in the channel
+   */
+  std::size_t GetNFreeSlots (void) const;
+
+private:
+  /**
+   * \param segment the 80 MHz segment (0 for the primary one)
+   * \param ruType the RU type
+   * \param index the RU index
+   * \return true if the given RU is legal for the channel and none of its tones is allocated
+   */
+  bool IsFree (std::size_t segment, HeRu::RuType ruType, std::size_t index) const;
+  /**
+   * \param segment the 80 MHz segment (0 for the primary one)
+   * \param ruType the RU type
+   * \param index the RU index
+   * \return the number of slots of the largest free RU including the given (free) RU
+   */
+  std::size_t GetLargestFreeAncestor (std::size_t segment, HeRu::RuType ruType, std::size_t index) const;
+  /**
+   * Find the free RU of the given type to allocate, if any.
+   *
+   * \param ruType the RU type
+   * \param segment the 80 MHz segment of the RU, if found
+   * \param index the index of the RU, if found
+   * \return true if a free RU of the given type has been found
+   */
+  bool FindBestFit (HeRu::RuType ruType, std::size_t& segment, std::size_t& index) const;
+
+  uint16_t m_bandwidth;      //!< the channel bandwidth in MHz
+  uint64_t m_occupied[2];    //!< bitmask of the allocated slots of each 80 MHz segment
+};
+
+} //namespace ns3
+
+#endif /* RU_ALLOCATOR_H */
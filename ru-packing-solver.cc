@@ -0,0 +1,200 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ru-packing-solver.h"
+#include "he-ru-tone-plan.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RuPackingSolver");
+
+namespace {
+
+/// A choice for a candidate: the RU type and the units and centers it takes
+struct RuChoice
+{
+  HeRu::RuType ruType;  //!< RU type
+  uint8_t units;        //!< number of units taken
+  uint8_t centers;      //!< number of centers taken
+};
+
+/// The choices available for a candidate (choice 0 means no RU). A 26-tone RU
+/// can either take a unit or a center.
+const RuChoice RU_CHOICES[] = {
+  {HeRu::RU_26_TONE, 0, 0},
+  {HeRu::RU_26_TONE, 1, 0},
+  {HeRu::RU_26_TONE, 0, 1},
+  {HeRu::RU_52_TONE, 2, 0},
+  {HeRu::RU_106_TONE, 4, 0},
+  {HeRu::RU_242_TONE, 8, 1},
+  {HeRu::RU_484_TONE, 16, 2},
+  {HeRu::RU_996_TONE, 32, 5},
+  {HeRu::RU_2x996_TONE, 64, 10}
+};
+
+/// Number of choices available for a candidate
+const std::size_t N_CHOICES = sizeof (RU_CHOICES) / sizeof (RU_CHOICES[0]);
+
+/// Maximum number of candidates for which no allocation is needed
+const std::size_t MAX_CANDIDATES = HeRuTonePlan::GetNRus (160, HeRu::RU_26_TONE) + 1;
+
+/// Maximum number of states (units and centers budgets of a 160 MHz channel)
+const std::size_t MAX_STATES = (8 * 8 + 1) * (8 + 2 + 1);
+
+} // anonymous namespace
+
+RuPackingSolver::RuPackingSolver ()
+  : m_budget (500000),
+    m_totalValue (0)
+{
+  m_value[0].reserve (MAX_STATES);
+  m_value[1].reserve (MAX_STATES);
+  m_choice.reserve (MAX_CANDIDATES * MAX_STATES);
+  m_solution.reserve (MAX_CANDIDATES);
+}
+
+void
+RuPackingSolver::SetBudget (uint64_t budget)
+{
+  m_budget = budget;
+}
+
+uint64_t
+RuPackingSolver::GetBudget (void) const
+{
+  return m_budget;
+}
+
+std::size_t
+RuPackingSolver::Solve (uint16_t bandwidth, const std::vector<uint64_t>& values, std::size_t nCandidates)
+{
+  NS_LOG_FUNCTION (this << bandwidth << nCandidates);
+  NS_ASSERT (values.size () >= nCandidates * HeRuTonePlan::N_RU_TYPES);
+
+  std::size_t nBlocks = HeRuTonePlan::GetNSlots (bandwidth) / 9;
+  std::size_t maxUnits = 8 * nBlocks;
+  std::size_t maxCenters = nBlocks + (bandwidth >= 80 ? HeRuTonePlan::GetNSegments (bandwidth) : 0);
+  std::size_t nCenterStates = maxCenters + 1;
+  std::size_t nStates = (maxUnits + 1) * nCenterStates;
+
+  // consider as many candidates as allowed by the budget
+  std::size_t maxCandidates = m_budget / (nStates * (N_CHOICES - 1));
+  if (nCandidates > maxCandidates)
+    {
+      NS_LOG_DEBUG ("Budget allows to consider " << maxCandidates << " out of "
+                    << nCandidates << " candidates");
+      nCandidates = maxCandidates;
+    }
+  m_solution.assign (nCandidates, 0);
+  m_totalValue = 0;
+  if (nCandidates == 0)
+    {
+      return 0;
+    }
+
+  // m_value[.][s] is the best value achievable with the units and centers
+  // corresponding to state s = units * nCenterStates + centers (-1 if unreachable)
+  std::vector<int64_t>* curr = &m_value[0];
+  std::vector<int64_t>* next = &m_value[1];
+  curr->assign (nStates, -1);
+  (*curr)[0] = 0;
+  m_choice.assign (nCandidates * nStates, 0);
+
+  for (std::size_t i = 0; i < nCandidates; i++)
+    {
+      *next = *curr;  // the candidate is not assigned an RU
+      uint8_t* choice = &m_choice[i * nStates];
+
+      for (std::size_t units = 0; units <= maxUnits; units++)
+        {
+          for (std::size_t centers = 0; centers <= maxCenters; centers++)
+            {
+              int64_t value = (*curr)[units * nCenterStates + centers];
+              if (value < 0)
+                {
+                  continue;
+                }
+              for (std::size_t c = 1; c < N_CHOICES; c++)
+                {
+                  std::size_t u = units + RU_CHOICES[c].units;
+                  std::size_t k = centers + RU_CHOICES[c].centers;
+                  if (u > maxUnits || k > maxCenters)
+                    {
+                      continue;
+                    }
+                  // smaller RUs are preferred in case of ties
+                  int64_t newValue = value + values[i * HeRuTonePlan::N_RU_TYPES + RU_CHOICES[c].ruType];
+                  std::size_t s = u * nCenterStates + k;
+                  if (newValue > (*next)[s])
+                    {
+                      (*next)[s] = newValue;
+                      choice[s] = c;
+                    }
+                }
+            }
+        }
+      std::swap (curr, next);
+    }
+
+  // find the best state, preferring those taking less resources in case of ties
+  std::size_t best = 0;
+  for (std::size_t s = 1; s < nStates; s++)
+    {
+      if ((*curr)[s] > (*curr)[best])
+        {
+          best = s;
+        }
+    }
+  m_totalValue = (*curr)[best];
+
+  // walk back through the choices to get the RU type of each candidate
+  for (std::size_t i = nCandidates; i-- > 0; )
+    {
+      uint8_t c = m_choice[i * nStates + best];
+      m_solution[i] = c;
+      best -= RU_CHOICES[c].units * nCenterStates + RU_CHOICES[c].centers;
+    }
+  NS_ASSERT (best == 0);
+
+  NS_LOG_DEBUG ("Solution value: " << m_totalValue);
+  return nCandidates;
+}
+
+bool
+RuPackingSolver::IsAssigned (std::size_t i) const
+{
+  NS_ASSERT (i < m_solution.size ());
+  return (m_solution[i] != 0);
+}
+
+HeRu::RuType
+RuPackingSolver::GetRuType (std::size_t i) const
+{
+  NS_ASSERT (IsAssigned (i));
+  return RU_CHOICES[m_solution[i]].ruType;
+}
+
+uint64_t
+RuPackingSolver::GetValue (void) const
+{
+  return m_totalValue;
+}
+
+} //namespace ns3
@@ -0,0 +1,106 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RU_PACKING_SOLVER_H
+#define RU_PACKING_SOLVER_H
+
+#include "he-ru.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * RuPackingSolver selects the type of the RU (if any) to assign to each
+ * candidate station so as to maximize the sum of the values of the assigned
+ * RUs (e.g., the bytes delivered in a DL MU PPDU), subject to the constraint
+ * that the selected RUs can be placed in the channel without overlapping.
+ *
+ * Whether a set of RUs fits in the channel only depends on two quantities,
+ * which makes a dynamic-programming (knapsack) formulation exact:
+ *
+ * - units: each 20 MHz block includes 8 units (the 26-tone RUs other than the
+ *   center one of the block); 26, 52 and 106-tone RUs take 1, 2 and 4 units,
+ *   while 242, 484, 996 and 2x996-tone RUs take all the units of the 1, 2, 4
+ *   and 8 blocks they span;
+ * - centers: the center 26-tone RUs of the 20 MHz blocks and of the 80 MHz
+ *   segments, which can only be taken by 26-tone RUs or by the larger RUs
+ *   including them.
+ *
+ * Since all the RU sizes are powers of two units and RUs are aligned, RUs
+ * sorted in decreasing order of size can always be placed (e.g., by the
+ * RuAllocator) if neither budget is exceeded.
+ */
+class RuPackingSolver
+{
+public:
+  RuPackingSolver ();
+
+  /**
+   * Set the maximum number of state updates performed by a call to Solve. This
+   * bounds the time taken by the solver independently of the host speed.
+   *
+   * \param budget the maximum number of state updates per call to Solve
+   */
+  void SetBudget (uint64_t budget);
+  /**
+   * \return the maximum number of state updates per call to Solve
+   */
+  uint64_t GetBudget (void) const;
+
+  /**
+   * Solve the RU packing problem for the first candidates. If the budget does
+   * not allow to consider all the given candidates, only the first ones are
+   * considered.
+   *
+   * \param bandwidth the channel bandwidth in MHz (20, 40, 80 or 160)
+   * \param values the value of assigning an RU of type t to the i-th candidate
+   *               is stored at position i * HeRuTonePlan::N_RU_TYPES + t
+   * \param nCandidates the number of candidates
+   * \return the number of candidates (from the first one) that have been
+   *         considered, zero if the budget does not allow to consider any
+   */
+  std::size_t Solve (uint16_t bandwidth, const std::vector<uint64_t>& values, std::size_t nCandidates);
+
+  /**
+   * \param i the index of a candidate considered by the last call to Solve
+   * \return whether the candidate is assigned an RU
+   */
+  bool IsAssigned (std::size_t i) const;
+  /**
+   * \param i the index of a candidate that is assigned an RU
+   * \return the type of the RU assigned to the candidate
+   */
+  HeRu::RuType GetRuType (std::size_t i) const;
+  /**
+   * \return the total value of the solution found by the last call to Solve
+   */
+  uint64_t GetValue (void) const;
+
+private:
+  uint64_t m_budget;                //!< maximum number of state updates per call to Solve
+  std::vector<int64_t> m_value[2];  //!< best value of each state (current and next candidate)
+  std::vector<uint8_t> m_choice;    //!< choice made for each candidate and state
+  std::vector<uint8_t> m_solution;  //!< choice made for each candidate by the last solution
+  uint64_t m_totalValue;            //!< value of the last solution
+};
+
+} //namespace ns3
+
+#endif /* RU_PACKING_SOLVER_H */
@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/buffer-status-estimator.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BufferStatusEstimatorTest");
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that, after interleaved buffer status reports, receptions,
+ * resets and changes of the decay time, the total estimate returned in
+ * constant time equals the sum of the unclamped estimates of the single
+ * stations, which re-bases the sums on every report, reset and change of the
+ * decay time.
+ */
+class BufferStatusEstimatorTotalTest : public TestCase
+{
+public:
+  BufferStatusEstimatorTotalTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BufferStatusEstimatorTotalTest::BufferStatusEstimatorTotalTest ()
+  : TestCase ("Check that the total estimate is the sum of the estimates of the stations")
+{
+}
+
+void
+BufferStatusEstimatorTotalTest::DoRun (void)
+{
+  const uint16_t maxAid = 10;
+  BufferStatusEstimator estimator (maxAid);
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (1);
+
+  // the state of the stations as notified to the estimator
+  std::vector<Time> reportTime (maxAid + 1);
+  std::vector<uint64_t> received (maxAid + 1, 0);
+  Time decayTime = MilliSeconds (50);
+  Time now = Seconds (0);
+  uint32_t nChecks = 0;
+
+  for (uint16_t step = 0; step < 2000; step++)
+    {
+      now += MicroSeconds (rng->GetInteger (0, 5000));
+      uint16_t aid = rng->GetInteger (1, maxAid);
+      uint32_t event = rng->GetInteger (0, 99);
+
+      if (event < 40)
+        {
+          estimator.NotifyReport (aid, rng->GetInteger (0, 50000), now);
+          reportTime[aid] = now;
+          received[aid] = 0;
+        }
+      else if (event < 90)
+        {
+          uint32_t bytes = rng->GetInteger (0, 3000);
+          estimator.NotifyReceived (aid, bytes);
+          received[aid] += bytes;
+        }
+      else if (event < 95)
+        {
+          estimator.Reset (aid);
+          received[aid] = 0;
+        }
+      else
+        {
+          decayTime = MilliSeconds (rng->GetInteger (10, 100));
+          estimator.SetDecayTime (decayTime);
+        }
+
+      // the total is checked at a random time after the last event
+      Time checkTime = now + MicroSeconds (rng->GetInteger (0, 10000));
+      double sum = 0;
+      std::size_t nReports = 0;
+      for (uint16_t a = 1; a <= maxAid; a++)
+        {
+          if (!estimator.HasReport (a))
+            {
+              continue;
+            }
+          nReports++;
+          double age = (checkTime - reportTime[a]).GetSeconds ();
+          double estimate = estimator.GetReportedBytes (a) * std::exp (-age / decayTime.GetSeconds ())
+                            + estimator.GetArrivalRate (a) * age - static_cast<double> (received[a]);
+          NS_TEST_EXPECT_MSG_EQ_TOL (static_cast<double> (estimator.GetEstimate (a, checkTime)),
+                                     std::max (estimate, 0.0), 1.0 + 1e-9 * std::abs (estimate),
+                                     "Unexpected estimate for station " << a << " at step " << step);
+          sum += estimate;
+        }
+      NS_TEST_EXPECT_MSG_EQ (estimator.GetNReports (), nReports, "Unexpected number of reports at step " << step);
+      NS_TEST_EXPECT_MSG_EQ_TOL (static_cast<double> (estimator.GetTotalEstimate (checkTime)),
+                                 std::max (sum, 0.0), 1.0 + 1e-9 * std::abs (sum),
+                                 "The total estimate differs from the sum of the estimates at step " << step);
+      nChecks += (sum > 0 ? 1 : 0);
+    }
+  // most of the checks must not be trivially satisfied by a zero total
+  NS_TEST_EXPECT_MSG_GT (nChecks, 1000, "Too few checks with a positive total estimate");
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief BufferStatusEstimator Test Suite
+ */
+class BufferStatusEstimatorTestSuite : public TestSuite
+{
+public:
+  BufferStatusEstimatorTestSuite ();
+};
+
+BufferStatusEstimatorTestSuite::BufferStatusEstimatorTestSuite ()
+  : TestSuite ("wifi-buffer-status-estimator", UNIT)
+{
+  AddTestCase (new BufferStatusEstimatorTotalTest, TestCase::QUICK);
+}
+
+static BufferStatusEstimatorTestSuite g_bufferStatusEstimatorTestSuite; ///< the test suite
@@ -0,0 +1,987 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/spectrum-wifi-helper.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/multi-model-spectrum-channel.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-mac-queue-item.h"
+#include "ns3/ap-wifi-mac.h"
+#include "ns3/ssid.h"
+#include "ns3/packet-socket-helper.h"
+#include "ns3/packet-socket-address.h"
+#include "ns3/packet-socket-client.h"
+#include "ns3/packet-socket-server.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/rr-ofdma-manager.h"
+#include "ns3/allocation-counter.h"
+#include "ns3/tx-duration-cache.h"
+#include "ns3/ctrl-headers.h"
+#include "ns3/mac-low.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/he-ru-tone-plan.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("RrOfdmaManagerTest");
+
+namespace {
+
+/// Number of heap allocations performed by the test program
+std::atomic<uint64_t> g_nAllocations (0);
+
+/**
+ * \return the number of heap allocations performed by the test program so far
+ */
+uint64_t
+GetNAllocations (void)
+{
+  return g_nAllocations.load (std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+/*
+ * The global operator new is replaced in the test program only, so that the
+ * heap allocations made by scheduling decisions can be counted through an
+ * AllocationScope. The array and sized variants of the default operators
+ * forward to these ones.
+ */
+void*
+operator new (std::size_t size)
+{
+  g_nAllocations.fetch_add (1, std::memory_order_relaxed);
+  void* ptr = std::malloc (size > 0 ? size : 1);
+  if (ptr == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return ptr;
+}
+
+void
+operator delete (void* ptr) noexcept
+{
+  std::free (ptr);
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the DL MU PPDU planned in advance is only invalidated by
+ * the changes affecting it, i.e., changes of the ring of backlogged stations,
+ * of the backlogged TIDs of the planned stations and of the BA agreements.
+ */
+class RrOfdmaLookaheadInvalidationTest : public TestCase
+{
+public:
+  RrOfdmaLookaheadInvalidationTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Notify the manager that an MPDU addressed to the given station has been
+   * enqueued or dequeued.
+   *
+   * \param manager the OFDMA manager
+   * \param address the MAC address of the station
+   * \param tid the TID of the MPDU
+   * \param enqueued whether the MPDU has been enqueued or dequeued
+   */
+  void UpdateBacklog (Ptr<RrOfdmaManager> manager, Mac48Address address, uint8_t tid, bool enqueued);
+};
+
+RrOfdmaLookaheadInvalidationTest::RrOfdmaLookaheadInvalidationTest ()
+  : TestCase ("Check the changes invalidating the DL MU PPDU planned in advance")
+{
+}
+
+void
+RrOfdmaLookaheadInvalidationTest::UpdateBacklog (Ptr<RrOfdmaManager> manager, Mac48Address address,
+                                                 uint8_t tid, bool enqueued)
+{
+  WifiMacHeader hdr;
+  hdr.SetType (WIFI_MAC_QOSDATA);
+  hdr.SetAddr1 (address);
+  hdr.SetQosTid (tid);
+  manager->UpdateBacklog (Create<WifiMacQueueItem> (Create<Packet> (1000), hdr), enqueued);
+}
+
+void
+RrOfdmaLookaheadInvalidationTest::DoRun (void)
+{
+  Ptr<RrOfdmaManager> manager = CreateObject<RrOfdmaManager> ();
+  Mac48Address sta1 ("00:00:00:00:00:01");
+  Mac48Address sta2 ("00:00:00:00:00:02");
+  manager->m_aidMap[sta1] = 1;
+  manager->m_staAddress[1] = sta1;
+  manager->m_aidMap[sta2] = 2;
+  manager->m_staAddress[2] = sta2;
+
+  // station 1 is a candidate of the plan made in advance, station 2 is not
+  manager->m_lookaheadMember[1] = 1;
+
+  uint64_t version = manager->m_dlStateVersion;
+  UpdateBacklog (manager, sta1, 0, true);
+  NS_TEST_EXPECT_MSG_GT (manager->m_dlStateVersion, version, "Station 1 joining the ring must invalidate the plan");
+
+  version = manager->m_dlStateVersion;
+  UpdateBacklog (manager, sta1, 0, true);
+  NS_TEST_EXPECT_MSG_EQ (manager->m_dlStateVersion, version, "A frame for an already backlogged TID must not invalidate the plan");
+
+  UpdateBacklog (manager, sta1, 5, true);
+  NS_TEST_EXPECT_MSG_GT (manager->m_dlStateVersion, version, "A new backlogged TID of a planned station must invalidate the plan");
+
+  version = manager->m_dlStateVersion;
+  UpdateBacklog (manager, sta2, 0, true);
+  NS_TEST_EXPECT_MSG_GT (manager->m_dlStateVersion, version, "Station 2 joining the ring must invalidate the plan");
+
+  version = manager->m_dlStateVersion;
+  UpdateBacklog (manager, sta2, 5, true);
+  NS_TEST_EXPECT_MSG_EQ (manager->m_dlStateVersion, version, "A new backlogged TID of a station that is not planned must not invalidate the plan");
+
+  UpdateBacklog (manager, sta2, 5, false);
+  NS_TEST_EXPECT_MSG_EQ (manager->m_dlStateVersion, version, "An emptied TID of a station that is not planned must not invalidate the plan");
+
+  UpdateBacklog (manager, sta1, 0, false);
+  NS_TEST_EXPECT_MSG_EQ (manager->m_dlStateVersion, version, "A TID of a planned station that is still backlogged must not invalidate the plan");
+
+  UpdateBacklog (manager, sta1, 0, false);
+  NS_TEST_EXPECT_MSG_GT (manager->m_dlStateVersion, version, "An emptied TID of a planned station must invalidate the plan");
+
+  version = manager->m_dlStateVersion;
+  manager->SetBaState (2, sta2, 0, false);
+  NS_TEST_EXPECT_MSG_EQ (manager->m_dlStateVersion, version, "A BA agreement that did not change must not invalidate the plan");
+}
+
+
+/**
+ * Set up a BSS in which the AP saturates the queues of the given number of
+ * stations from 1 s to 1.5 s, and stop the simulation at 1.6 s. The simulation
+ * is not run, so that the caller can schedule checks in advance.
+ *
+ * \param nStations the number of stations
+ * \param ackSequence the ack sequence of the DL MU PPDUs
+ * \param lookahead whether DL MU PPDUs are planned in advance
+ * \return the OFDMA manager of the AP
+ */
+static Ptr<RrOfdmaManager>
+SetupSaturatedBss (uint16_t nStations, DlMuAckSequenceType ackSequence, bool lookahead)
+{
+  NodeContainer apNode;
+  apNode.Create (1);
+  NodeContainer staNodes;
+  staNodes.Create (nStations);
+
+  Ptr<MultiModelSpectrumChannel> channel = CreateObject<MultiModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  SpectrumWifiPhyHelper phy = SpectrumWifiPhyHelper::Default ();
+  phy.SetChannel (channel);
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211ax_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue ("HeMcs7"),
+                                "ControlMode", StringValue ("HeMcs7"));
+  wifi.SetAckPolicySelectorForAc (AC_BE, "ns3::ConstantWifiAckPolicySelector",
+                                  "DlAckSequenceType", UintegerValue (ackSequence));
+
+  WifiMacHelper mac;
+  Ssid ssid ("rr-ofdma-manager");
+  mac.SetType ("ns3::StaWifiMac",
+               "Ssid", SsidValue (ssid));
+  NetDeviceContainer staDevices = wifi.Install (phy, mac, staNodes);
+
+  mac.SetOfdmaManager ("ns3::RrOfdmaManager",
+                       "NStations", UintegerValue (nStations),
+                       "ForceDlOfdma", BooleanValue (true),
+                       "Lookahead", BooleanValue (lookahead));
+  mac.SetType ("ns3::ApWifiMac",
+               "Ssid", SsidValue (ssid));
+  NetDeviceContainer apDevice = wifi.Install (phy, mac, apNode);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (apNode);
+  mobility.Install (staNodes);
+
+  // the AP saturates the queues of all the stations
+  PacketSocketHelper packetSocket;
+  packetSocket.Install (apNode);
+  packetSocket.Install (staNodes);
+
+  for (uint16_t i = 0; i < nStations; i++)
+    {
+      PacketSocketAddress socket;
+      socket.SetSingleDevice (apDevice.Get (0)->GetIfIndex ());
+      socket.SetPhysicalAddress (staDevices.Get (i)->GetAddress ());
+      socket.SetProtocol (1);
+
+      Ptr<PacketSocketClient> client = CreateObject<PacketSocketClient> ();
+      client->SetAttribute ("PacketSize", UintegerValue (1000));
+      client->SetAttribute ("MaxPackets", UintegerValue (0));
+      client->SetAttribute ("Interval", TimeValue (MicroSeconds (50)));
+      client->SetRemote (socket);
+      apNode.Get (0)->AddApplication (client);
+      client->SetStartTime (Seconds (1.0));
+      client->SetStopTime (Seconds (1.5));
+
+      Ptr<PacketSocketServer> server = CreateObject<PacketSocketServer> ();
+      server->SetLocal (socket);
+      staNodes.Get (i)->AddApplication (server);
+      server->SetStartTime (Seconds (0.0));
+      server->SetStopTime (Seconds (1.6));
+    }
+
+  Simulator::Stop (Seconds (1.6));
+
+  Ptr<WifiNetDevice> apDev = DynamicCast<WifiNetDevice> (apDevice.Get (0));
+  return apDev->GetMac ()->GetObject<RrOfdmaManager> ();
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test the number of DL MU PPDUs planned in advance that are committed
+ * (hits) or discarded (misses) in a BSS where the AP saturates the queues of
+ * the stations.
+ */
+class RrOfdmaLookaheadTest : public TestCase
+{
+public:
+  /**
+   * Constructor
+   *
+   * \param lookahead whether DL MU PPDUs are planned in advance
+   */
+  RrOfdmaLookaheadTest (bool lookahead);
+
+private:
+  virtual void DoRun (void);
+
+  bool m_lookahead;  ///< whether DL MU PPDUs are planned in advance
+};
+
+RrOfdmaLookaheadTest::RrOfdmaLookaheadTest (bool lookahead)
+  : TestCase (std::string ("Check the lookahead hit and miss counters with Lookahead=")
+              + (lookahead ? "true" : "false")),
+    m_lookahead (lookahead)
+{
+}
+
+void
+RrOfdmaLookaheadTest::DoRun (void)
+{
+  Ptr<RrOfdmaManager> manager = SetupSaturatedBss (4, DlMuAckSequenceType::DL_SU_FORMAT, m_lookahead);
+  NS_TEST_ASSERT_MSG_NE (manager, 0, "The AP has no RrOfdmaManager");
+  Simulator::Run ();
+
+  uint64_t hits = manager->GetNLookaheadHits ();
+  uint64_t misses = manager->GetNLookaheadMisses ();
+  NS_LOG_INFO ("Decisions: " << manager->GetNDecisions () << " lookahead hits: " << hits
+               << " misses: " << misses);
+
+  NS_TEST_EXPECT_MSG_LT_OR_EQ (hits + misses, manager->GetNDecisions (),
+                               "A plan made in advance is checked at most once per decision");
+  if (m_lookahead)
+    {
+      // the set of backlogged stations and their TIDs do not change while the
+      // queues are saturated, hence most of the plans are committed
+      NS_TEST_EXPECT_MSG_GT (hits, 0, "No DL MU PPDU planned in advance was committed");
+      NS_TEST_EXPECT_MSG_GT (hits, misses, "Most of the DL MU PPDUs planned in advance should be committed");
+    }
+  else
+    {
+      NS_TEST_EXPECT_MSG_EQ (hits, 0, "No DL MU PPDU is planned in advance if Lookahead is disabled");
+      NS_TEST_EXPECT_MSG_EQ (misses, 0, "No DL MU PPDU is planned in advance if Lookahead is disabled");
+    }
+
+  Simulator::Destroy ();
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that collecting the candidate stations and assigning them RUs
+ * does not allocate memory once the manager has reserved its scratch storage.
+ */
+class RrOfdmaAllocationTest : public TestCase
+{
+public:
+  RrOfdmaAllocationTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+RrOfdmaAllocationTest::RrOfdmaAllocationTest ()
+  : TestCase ("Check the heap allocations made to assign RUs to the candidate stations")
+{
+}
+
+void
+RrOfdmaAllocationTest::DoRun (void)
+{
+  AllocationScope::SetCounter (&GetNAllocations);
+  NS_TEST_ASSERT_MSG_EQ (AllocationScope::IsEnabled (), true, "Heap allocations are not counted");
+
+  const uint16_t nCandidates = 12;
+  Ptr<RrOfdmaManager> manager = CreateObject<RrOfdmaManager> ();
+  RrOfdmaManager::SuTxInfo suTxInfo = {WifiPhy::GetHeMcs7 (), 1, Seconds (0), 0};
+  std::vector<Mac48Address> addresses;
+  for (uint16_t aid = 1; aid <= nCandidates; aid++)
+    {
+      addresses.push_back (Mac48Address::Allocate ());
+    }
+
+  // the first decision must not allocate either, because the scratch storage
+  // is reserved by the constructor
+  for (uint8_t decision = 0; decision < 2; decision++)
+    {
+      uint64_t nAllocations = 0;
+      std::size_t nStations = 9;
+      {
+        AllocationScope allocationScope (nAllocations);
+        manager->m_candidates.Clear ();
+        manager->m_ranking.clear ();
+        for (uint16_t aid = 1; aid <= nCandidates; aid++)
+          {
+            // four bulk send, four on/off and four HTTP candidates
+            RrOfdmaManager::TrafficClass tc = (aid <= 4 ? RrOfdmaManager::TC_BULK_SEND
+                                               : (aid <= 8 ? RrOfdmaManager::TC_ON_OFF
+                                                  : RrOfdmaManager::TC_HTTP));
+            uint32_t holSize = 500 + 100 * ((aid * 7) % nCandidates);
+            manager->m_ranking.push_back (manager->m_candidates.Add (addresses[aid - 1], aid, 0, holSize,
+                                                                     holSize, suTxInfo, tc));
+          }
+        manager->GetNumberAndTypeOfRus (80, nStations);
+      }
+      NS_LOG_INFO ("Decision " << +decision << ": " << nAllocations << " heap allocations, "
+                   << nStations << " RUs assigned");
+      NS_TEST_EXPECT_MSG_GT (nStations, 0, "No RU was assigned");
+      NS_TEST_EXPECT_MSG_EQ (nAllocations, 0, "Assigning RUs to the candidates allocated memory");
+    }
+  NS_TEST_EXPECT_MSG_EQ (manager->GetNScratchAllocations (), 0, "The ranking scratch storage was reallocated");
+
+  AllocationScope::SetCounter (0);
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the candidates are ranked as by the original scheduler,
+ * which split the candidates into per-class vectors (on/off, bulk send and
+ * HTTP, in this order) and merge sorted each of them in decreasing order of
+ * head-of-line frame size, preserving the order of candidates of equal size.
+ */
+class RrOfdmaRankingTest : public TestCase
+{
+public:
+  RrOfdmaRankingTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Merge the two sorted halves [p, q] and [q+1, r] of the given vector of
+   * candidates, as done by the original scheduler.
+   *
+   * \param v the candidates
+   * \param holSize the head-of-line frame size of the candidates
+   * \param p the first position of the left half
+   * \param q the last position of the left half
+   * \param r the last position of the right half
+   */
+  static void Merge (std::vector<uint16_t>& v, const std::vector<uint32_t>& holSize, int p, int q, int r);
+  /**
+   * Merge sort the positions [p, r] of the given vector of candidates in
+   * decreasing order of head-of-line frame size, as done by the original scheduler.
+   *
+   * \param v the candidates
+   * \param holSize the head-of-line frame size of the candidates
+   * \param p the first position to sort
+   * \param r the last position to sort
+   */
+  static void MergeSort (std::vector<uint16_t>& v, const std::vector<uint32_t>& holSize, int p, int r);
+};
+
+RrOfdmaRankingTest::RrOfdmaRankingTest ()
+  : TestCase ("Check that candidates are ranked as by the original merge sort")
+{
+}
+
+void
+RrOfdmaRankingTest::Merge (std::vector<uint16_t>& v, const std::vector<uint32_t>& holSize, int p, int q, int r)
+{
+  std::vector<uint16_t> left (v.begin () + p, v.begin () + q + 1);
+  std::vector<uint16_t> right (v.begin () + q + 1, v.begin () + r + 1);
+  std::size_t i = 0;
+  std::size_t j = 0;
+  int k = p;
+  while (i < left.size () && j < right.size ())
+    {
+      v[k++] = (holSize[left[i]] >= holSize[right[j]] ? left[i++] : right[j++]);
+    }
+  while (i < left.size ())
+    {
+      v[k++] = left[i++];
+    }
+  while (j < right.size ())
+    {
+      v[k++] = right[j++];
+    }
+}
+
+void
+RrOfdmaRankingTest::MergeSort (std::vector<uint16_t>& v, const std::vector<uint32_t>& holSize, int p, int r)
+{
+  if (p < r)
+    {
+      int q = (p + r) / 2;
+      MergeSort (v, holSize, p, q);
+      MergeSort (v, holSize, q + 1, r);
+      Merge (v, holSize, p, q, r);
+    }
+}
+
+void
+RrOfdmaRankingTest::DoRun (void)
+{
+  // candidates in ring order, with several frames of equal size
+  const uint32_t holSizes[] = {1500, 800, 1500, 300, 1200, 800, 1500, 100, 1200, 1200,
+                               900, 1500, 300, 800, 800, 1000, 1500, 200, 1200, 700};
+  const RrOfdmaManager::TrafficClass classes[] = {RrOfdmaManager::TC_ON_OFF,
+                                                  RrOfdmaManager::TC_BULK_SEND,
+                                                  RrOfdmaManager::TC_HTTP};
+  const std::size_t nCandidates = sizeof (holSizes) / sizeof (holSizes[0]);
+
+  Ptr<RrOfdmaManager> manager = CreateObject<RrOfdmaManager> ();
+  RrOfdmaManager::SuTxInfo suTxInfo = {WifiPhy::GetHeMcs7 (), 1, Seconds (0), 0};
+
+  // only the first k candidates of each class are ranked by the manager, hence
+  // the comparison is restricted to them
+  for (std::size_t k : {std::size_t (3), nCandidates})
+    {
+      manager->m_candidates.Clear ();
+      manager->m_ranking.clear ();
+      for (uint16_t c = 0; c < nCandidates; c++)
+        {
+          manager->m_ranking.push_back (manager->m_candidates.Add (Mac48Address::Allocate (), c + 1, 0,
+                                                                   holSizes[c], holSizes[c], suTxInfo,
+                                                                   classes[(c * 7) % 3]));
+        }
+
+      std::size_t first[RrOfdmaManager::TC_UNCLASSIFIED + 1];
+      std::size_t last[RrOfdmaManager::TC_UNCLASSIFIED + 1];
+      manager->SortByTrafficClass (first, last);
+
+      for (auto tc : classes)
+        {
+          RrOfdmaManager::RankIt begin = manager->m_ranking.begin ();
+          manager->RankCandidates (begin + first[tc], begin + last[tc], k);
+
+          std::vector<uint16_t> reference;
+          for (uint16_t c = 0; c < nCandidates; c++)
+            {
+              if (manager->m_candidates.trafficClass[c] == tc)
+                {
+                  reference.push_back (c);
+                }
+            }
+          MergeSort (reference, manager->m_candidates.holSize, 0, static_cast<int> (reference.size ()) - 1);
+
+          NS_TEST_ASSERT_MSG_EQ (last[tc] - first[tc], reference.size (), "Unexpected number of candidates of class " << +tc);
+          for (std::size_t i = 0; i < std::min (k, reference.size ()); i++)
+            {
+              NS_TEST_EXPECT_MSG_EQ (manager->m_ranking[first[tc] + i], reference[i],
+                                     "Unexpected candidate at position " << i << " of class " << +tc
+                                     << " (k=" << k << ")");
+            }
+        }
+      NS_TEST_EXPECT_MSG_EQ (last[RrOfdmaManager::TC_HTTP], nCandidates, "Unclassified candidates found");
+    }
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the TX durations returned by the TX duration cache match
+ * the ones computed by the PHY, on cache misses and hits, and that the cache
+ * is flushed when the PHY parameters change.
+ */
+class RrOfdmaTxDurationCacheTest : public TestCase
+{
+public:
+  RrOfdmaTxDurationCacheTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Look up the TX durations of all the combinations of RU type, MCS, NSS
+   * and PSDU size twice (the second lookup is expected to hit the cache) and
+   * compare them with the ones computed by the PHY.
+   *
+   * \param cache the TX duration cache
+   * \param guardInterval the guard interval in nanoseconds
+   */
+  void CheckTxDurations (TxDurationCache& cache, uint16_t guardInterval);
+
+  uint64_t m_nLookups;  ///< number of combinations looked up
+};
+
+RrOfdmaTxDurationCacheTest::RrOfdmaTxDurationCacheTest ()
+  : TestCase ("Check that the TX duration cache returns the TX durations computed by the PHY"),
+    m_nLookups (0)
+{
+}
+
+void
+RrOfdmaTxDurationCacheTest::CheckTxDurations (TxDurationCache& cache, uint16_t guardInterval)
+{
+  const uint16_t channelWidth = 80;
+  const uint16_t frequency = 5210;
+  const uint16_t staId = 1;
+  cache.SetPhyParameters (channelWidth, guardInterval, frequency);
+
+  for (auto ruType : {HeRu::RU_26_TONE, HeRu::RU_106_TONE, HeRu::RU_484_TONE, HeRu::RU_996_TONE})
+    {
+      for (uint8_t mcs : {0, 7, 11})
+        {
+          for (uint8_t nss : {1, 2})
+            {
+              for (uint32_t size : {1, 1500, 6000, 65535})
+                {
+                  WifiTxVector txVector;
+                  txVector.SetPreambleType (WIFI_PREAMBLE_HE_MU);
+                  txVector.SetChannelWidth (channelWidth);
+                  txVector.SetGuardInterval (guardInterval);
+                  txVector.SetHeMuUserInfo (staId, {{true, ruType, 1}, WifiPhy::GetHeMcs (mcs), nss});
+                  Time expected = WifiPhy::CalculateTxDuration (size, txVector, frequency, staId);
+
+                  NS_TEST_EXPECT_MSG_EQ (cache.GetTxDuration (size, txVector, staId), expected,
+                                         "Unexpected TX duration on a cache miss (RU type=" << ruType
+                                         << " MCS=" << +mcs << " NSS=" << +nss << " size=" << size << ")");
+                  NS_TEST_EXPECT_MSG_EQ (cache.GetTxDuration (size, txVector, staId), expected,
+                                         "Unexpected TX duration on a cache hit (RU type=" << ruType
+                                         << " MCS=" << +mcs << " NSS=" << +nss << " size=" << size << ")");
+                  m_nLookups++;
+                }
+            }
+        }
+    }
+}
+
+void
+RrOfdmaTxDurationCacheTest::DoRun (void)
+{
+  TxDurationCache cache (16);
+
+  CheckTxDurations (cache, 800);
+  NS_TEST_EXPECT_MSG_EQ (cache.GetNMisses (), m_nLookups, "The first lookup of each combination should miss");
+  NS_TEST_EXPECT_MSG_EQ (cache.GetNHits (), m_nLookups, "The second lookup of each combination should hit");
+
+  // changing the guard interval must flush the cache, otherwise the durations
+  // computed with the previous guard interval would be returned
+  CheckTxDurations (cache, 3200);
+  NS_TEST_EXPECT_MSG_EQ (cache.GetNMisses (), m_nLookups, "The first lookup of each combination should miss");
+  NS_TEST_EXPECT_MSG_EQ (cache.GetNHits (), m_nLookups, "The second lookup of each combination should hit");
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the caches used by the scheduling decisions are hit in a
+ * BSS where the AP saturates the queues of the stations, and that the overhead
+ * of the DL MU ack sequence returned by the cache matches the one computed
+ * without the cache.
+ */
+class RrOfdmaDecisionCacheTest : public TestCase
+{
+public:
+  RrOfdmaDecisionCacheTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Compare the UL length of the HE TB PPDUs carrying the Block Acks and the
+   * response duration of the last DL MU PPDU with the values computed without
+   * the ack overhead cache.
+   *
+   * \param manager the OFDMA manager
+   */
+  void CheckDlAckOverhead (Ptr<RrOfdmaManager> manager);
+
+  uint32_t m_nChecks;  ///< number of DL MU PPDUs whose ack overhead was checked
+};
+
+RrOfdmaDecisionCacheTest::RrOfdmaDecisionCacheTest ()
+  : TestCase ("Check the caches used by the scheduling decisions"),
+    m_nChecks (0)
+{
+}
+
+void
+RrOfdmaDecisionCacheTest::CheckDlAckOverhead (Ptr<RrOfdmaManager> manager)
+{
+  if (manager->m_txVector.GetPreambleType () != WIFI_PREAMBLE_HE_MU
+      || manager->m_txParams.GetDlMuAckSequenceType () != DlMuAckSequenceType::DL_MU_BAR)
+    {
+      // the last decision did not prepare a DL MU PPDU acknowledged via MU-BAR
+      return;
+    }
+
+  // compute the overhead without the cache, as done before the cache was introduced
+  CtrlTriggerHeader trigger = manager->GetTriggerFrameHeader (manager->m_txVector, 5);
+  uint16_t ulLength = manager->m_low->CalculateUlLengthForBlockAcks (trigger, manager->m_txParams);
+  trigger.SetUlLength (ulLength);
+  Time response = manager->GetResponseDuration (manager->m_txParams, manager->m_txVector, trigger);
+
+  AckOverheadCache::Entry& entry = manager->LookupDlAckOverhead ();
+  NS_TEST_EXPECT_MSG_EQ (manager->GetDlAckUlLength (entry, trigger), ulLength,
+                         "The cached UL length differs from the computed one");
+  uint64_t hits = manager->GetNAckOverheadCacheHits ();
+  NS_TEST_EXPECT_MSG_EQ (manager->GetDlResponseDuration (), response,
+                         "The cached response duration differs from the computed one");
+  NS_TEST_EXPECT_MSG_EQ (manager->GetNAckOverheadCacheHits (), hits + 1,
+                         "The ack overhead of the last DL MU PPDU should be found in the cache");
+  m_nChecks++;
+}
+
+void
+RrOfdmaDecisionCacheTest::DoRun (void)
+{
+  Ptr<RrOfdmaManager> manager = SetupSaturatedBss (4, DlMuAckSequenceType::DL_MU_BAR, false);
+  NS_TEST_ASSERT_MSG_NE (manager, 0, "The AP has no RrOfdmaManager");
+  for (Time check = Seconds (1.1); check < Seconds (1.5); check += MilliSeconds (50))
+    {
+      Simulator::Schedule (check, &RrOfdmaDecisionCacheTest::CheckDlAckOverhead, this, manager);
+    }
+  Simulator::Run ();
+
+  NS_LOG_INFO ("Decisions: " << manager->GetNDecisions ()
+               << " TX duration cache hits: " << manager->GetNTxDurationCacheHits ()
+               << " misses: " << manager->GetNTxDurationCacheMisses ());
+  // the receivers of the DL MU PPDUs, their RUs and MCSs do not change while
+  // the queues are saturated, hence the same TX durations are computed again
+  NS_TEST_EXPECT_MSG_GT (manager->GetNTxDurationCacheMisses (), 0, "No TX duration was computed");
+  NS_TEST_EXPECT_MSG_GT (manager->GetNTxDurationCacheHits (), manager->GetNTxDurationCacheMisses (),
+                         "Most of the TX durations should be found in the cache");
+
+  NS_LOG_INFO ("Ack overhead cache hits: " << manager->GetNAckOverheadCacheHits ()
+               << " misses: " << manager->GetNAckOverheadCacheMisses ()
+               << " checks: " << m_nChecks);
+  // the same receivers, RUs and BA agreements are used by the DL MU PPDUs
+  NS_TEST_EXPECT_MSG_GT (m_nChecks, 0, "No DL MU PPDU acknowledged via MU-BAR was checked");
+  NS_TEST_EXPECT_MSG_GT (manager->GetNAckOverheadCacheHits (), manager->GetNAckOverheadCacheMisses (),
+                         "Most of the ack overheads should be found in the cache");
+
+  Simulator::Destroy ();
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test the plan of the DL MU PPDUs of a TXOP built from a synthetic
+ * round robin ring: the stations are grouped by decreasing demand, a station
+ * that does not fit is skipped while the following ones are still considered,
+ * the next TXOP starts from the first skipped station and the last PPDU is
+ * shortened to fit in the remaining TXOP.
+ */
+class RrOfdmaTxopPlanTest : public TestCase
+{
+public:
+  RrOfdmaTxopPlanTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Build the TXOP plan for the given stations.
+   *
+   * \param manager the OFDMA manager
+   * \param aids the AIDs of the stations, in round robin order
+   * \param demands the time (in microseconds) needed by the stations
+   * \param groupSize the number of stations served by a PPDU
+   * \param remaining the remaining TXOP (in microseconds)
+   * \param nextAid the station following the last one in round robin order
+   */
+  static void BuildPlan (Ptr<RrOfdmaManager> manager, const std::vector<uint16_t>& aids,
+                         const std::vector<uint64_t>& demands, std::size_t groupSize,
+                         uint64_t remaining, uint16_t nextAid);
+  /**
+   * Check the PPDUs of the TXOP plan.
+   *
+   * \param manager the OFDMA manager
+   * \param aids the expected AIDs of the stations of the plan
+   * \param slots the expected number of stations and duration (in microseconds) of the PPDUs
+   * \param nextStart the expected station to start with after the plan
+   */
+  void CheckPlan (Ptr<RrOfdmaManager> manager, const std::vector<uint16_t>& aids,
+                  const std::vector<std::pair<std::size_t, uint64_t>>& slots, uint16_t nextStart);
+};
+
+RrOfdmaTxopPlanTest::RrOfdmaTxopPlanTest ()
+  : TestCase ("Check the plan of the DL MU PPDUs of a TXOP")
+{
+}
+
+void
+RrOfdmaTxopPlanTest::BuildPlan (Ptr<RrOfdmaManager> manager, const std::vector<uint16_t>& aids,
+                                const std::vector<uint64_t>& demands, std::size_t groupSize,
+                                uint64_t remaining, uint16_t nextAid)
+{
+  manager->m_txopPlanEntries.clear ();
+  for (std::size_t i = 0; i < aids.size (); i++)
+    {
+      manager->m_txopPlanEntries.push_back ({MicroSeconds (demands[i]), static_cast<uint16_t> (i), aids[i]});
+    }
+  manager->m_dlTxopRemaining = MicroSeconds (remaining);
+  manager->BuildTxopPlan (groupSize, MicroSeconds (100), nextAid);
+}
+
+void
+RrOfdmaTxopPlanTest::CheckPlan (Ptr<RrOfdmaManager> manager, const std::vector<uint16_t>& aids,
+                                const std::vector<std::pair<std::size_t, uint64_t>>& slots, uint16_t nextStart)
+{
+  NS_TEST_ASSERT_MSG_EQ (manager->m_txopPlanAids.size (), aids.size (), "Unexpected number of planned stations");
+  for (std::size_t i = 0; i < aids.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (manager->m_txopPlanAids[i], aids[i], "Unexpected station at position " << i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (manager->m_txopSlots.size (), slots.size (), "Unexpected number of planned PPDUs");
+  std::size_t first = 0;
+  for (std::size_t i = 0; i < slots.size (); i++)
+    {
+      const RrOfdmaManager::TxopSlot& slot = manager->m_txopSlots[i];
+      NS_TEST_EXPECT_MSG_EQ (slot.first, first, "Unexpected first station of PPDU " << i);
+      NS_TEST_EXPECT_MSG_EQ (slot.nStations, slots[i].first, "Unexpected number of stations of PPDU " << i);
+      NS_TEST_EXPECT_MSG_EQ (slot.duration, MicroSeconds (slots[i].second), "Unexpected duration of PPDU " << i);
+      first += slot.nStations;
+    }
+  NS_TEST_EXPECT_MSG_EQ (manager->m_nextTxopSlot, 0, "The plan should start from the first PPDU");
+  NS_TEST_EXPECT_MSG_EQ (manager->m_txopPlanNextStart, nextStart, "Unexpected station to start with");
+}
+
+void
+RrOfdmaTxopPlanTest::DoRun (void)
+{
+  Ptr<RrOfdmaManager> manager = CreateObject<RrOfdmaManager> ();
+
+  // PPDUs serving two stations, 100 us between two PPDUs. Stations 9 and 3
+  // need the same time and are kept in round robin order. The third PPDU
+  // cannot start with station 5 (1000 + 200 + 100 > 1150 us), which is
+  // skipped, but station 2 needs less time and fits
+  BuildPlan (manager, {5, 7, 9, 11, 2, 3}, {200, 500, 300, 400, 50, 300}, 2, 1150, 4);
+  CheckPlan (manager, {7, 11, 9, 3, 2}, {{2, 500}, {2, 300}, {1, 50}}, 5);
+
+  // the next TXOP starts from the skipped station that comes first in round
+  // robin order, even if it needs less time than other skipped stations
+  BuildPlan (manager, {5, 7, 9, 11, 2, 3}, {200, 500, 300, 400, 150, 300}, 2, 1150, 4);
+  CheckPlan (manager, {7, 11, 9, 3}, {{2, 500}, {2, 300}}, 5);
+
+  // all the stations fit: the next TXOP starts from the station following the
+  // last one in round robin order
+  BuildPlan (manager, {5, 7, 9}, {200, 500, 300}, 2, 10000, 13);
+  CheckPlan (manager, {7, 9, 5}, {{2, 500}, {1, 200}}, 13);
+
+  // the first PPDU is planned even if it does not fit and is shortened to
+  // fit in the remaining TXOP along with its acknowledgment
+  BuildPlan (manager, {4, 6, 8}, {800, 100, 50}, 2, 550, 10);
+  CheckPlan (manager, {4, 6}, {{2, 450}}, 8);
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the score of the RU layouts of a 20 or 40 MHz channel is
+ * the maximum over all the assignments of the RUs of the layout to the
+ * candidates (found by enumeration), and that the assignment returned for a
+ * layout achieves the score.
+ */
+class RrOfdmaRuLayoutTest : public TestCase
+{
+public:
+  RrOfdmaRuLayoutTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Compute by enumeration the maximum value delivered by assigning the RUs
+   * left to the candidates starting from the given one.
+   *
+   * \param values the value of each RU type for each candidate
+   * \param nCandidates the number of candidates
+   * \param i the first candidate to assign
+   * \param left the number of RUs of each type left
+   * \return the maximum value
+   */
+  static uint64_t Enumerate (const std::vector<uint64_t>& values, std::size_t nCandidates,
+                             std::size_t i, uint8_t* left);
+};
+
+RrOfdmaRuLayoutTest::RrOfdmaRuLayoutTest ()
+  : TestCase ("Check the scores of the RU layouts of a 20 or 40 MHz channel")
+{
+}
+
+uint64_t
+RrOfdmaRuLayoutTest::Enumerate (const std::vector<uint64_t>& values, std::size_t nCandidates,
+                                std::size_t i, uint8_t* left)
+{
+  if (i == nCandidates)
+    {
+      return 0;
+    }
+  // the candidate is not assigned an RU
+  uint64_t best = Enumerate (values, nCandidates, i + 1, left);
+  for (std::size_t t = 0; t < HeRuTonePlan::N_LAYOUT_RU_TYPES; t++)
+    {
+      if (left[t] > 0)
+        {
+          left[t]--;
+          best = std::max (best, values[i * HeRuTonePlan::N_RU_TYPES + t]
+                                 + Enumerate (values, nCandidates, i + 1, left));
+          left[t]++;
+        }
+    }
+  return best;
+}
+
+void
+RrOfdmaRuLayoutTest::DoRun (void)
+{
+  using namespace HeRuTonePlan;
+
+  Ptr<RrOfdmaManager> manager = CreateObject<RrOfdmaManager> ();
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (1);
+
+  for (uint16_t bandwidth : {20, 40})
+    {
+      const uint8_t (*layouts)[N_LAYOUT_RU_TYPES] = (bandwidth == 20 ? RU_LAYOUTS_20MHZ : RU_LAYOUTS_40MHZ);
+      const std::size_t nLayouts = (bandwidth == 20 ? N_LAYOUTS_20MHZ : N_LAYOUTS_40MHZ);
+
+      for (std::size_t nCandidates = 1; nCandidates <= 6; nCandidates++)
+        {
+          // the bytes a candidate can receive do not decrease with the RU size
+          manager->m_ruValues.assign (nCandidates * N_RU_TYPES, 0);
+          for (std::size_t i = 0; i < nCandidates; i++)
+            {
+              uint64_t value = 0;
+              for (std::size_t t = 0; t < N_LAYOUT_RU_TYPES; t++)
+                {
+                  value += rng->GetInteger (0, 1000);
+                  manager->m_ruValues[i * N_RU_TYPES + t] = value;
+                }
+            }
+
+          for (std::size_t l = 0; l < nLayouts; l++)
+            {
+              uint8_t left[N_LAYOUT_RU_TYPES];
+              std::copy (layouts[l], layouts[l] + N_LAYOUT_RU_TYPES, left);
+              uint64_t expected = Enumerate (manager->m_ruValues, nCandidates, 0, left);
+              NS_TEST_EXPECT_MSG_EQ (manager->ScoreRuLayout (layouts[l], nCandidates, false), expected,
+                                     "Wrong score of layout " << l << " at " << bandwidth << " MHz with "
+                                     << nCandidates << " candidates");
+
+              // the assignment uses the RUs of the layout and achieves the score
+              NS_TEST_EXPECT_MSG_EQ (manager->ScoreRuLayout (layouts[l], nCandidates, true), expected,
+                                     "The score changed when computing the assignment");
+              NS_TEST_ASSERT_MSG_EQ (manager->m_candidateOrder.size (), nCandidates,
+                                     "Unexpected number of assigned candidates");
+              uint64_t value = 0;
+              uint8_t used[N_LAYOUT_RU_TYPES] = {};
+              for (std::size_t i = 0; i < nCandidates; i++)
+                {
+                  std::size_t t = manager->m_candidateOrder[i];
+                  if (t < N_LAYOUT_RU_TYPES)
+                    {
+                      used[t]++;
+                      value += manager->m_ruValues[i * N_RU_TYPES + t];
+                    }
+                }
+              for (std::size_t t = 0; t < N_LAYOUT_RU_TYPES; t++)
+                {
+                  NS_TEST_EXPECT_MSG_EQ ((used[t] <= layouts[l][t]), true, "Too many RUs of type " << t
+                                         << " assigned in layout " << l);
+                }
+              NS_TEST_EXPECT_MSG_EQ (value, expected, "The assignment of layout " << l
+                                     << " does not achieve the score");
+            }
+        }
+    }
+}
+
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief RrOfdmaManager Test Suite
+ */
+class RrOfdmaManagerTestSuite : public TestSuite
+{
+public:
+  RrOfdmaManagerTestSuite ();
+};
+
+RrOfdmaManagerTestSuite::RrOfdmaManagerTestSuite ()
+  : TestSuite ("wifi-rr-ofdma-manager", UNIT)
+{
+  AddTestCase (new RrOfdmaLookaheadInvalidationTest, TestCase::QUICK);
+  AddTestCase (new RrOfdmaAllocationTest, TestCase::QUICK);
+  AddTestCase (new RrOfdmaRankingTest, TestCase::QUICK);
+  AddTestCase (new RrOfdmaTxDurationCacheTest, TestCase::QUICK);
+  AddTestCase (new RrOfdmaLookaheadTest (false), TestCase::QUICK);
+  AddTestCase (new RrOfdmaLookaheadTest (true), TestCase::QUICK);
+  AddTestCase (new RrOfdmaDecisionCacheTest, TestCase::QUICK);
+  AddTestCase (new RrOfdmaTxopPlanTest, TestCase::QUICK);
+  AddTestCase (new RrOfdmaRuLayoutTest, TestCase::QUICK);
+}
+
+static RrOfdmaManagerTestSuite g_rrOfdmaManagerTestSuite; ///< the test suite
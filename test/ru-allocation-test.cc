@@ -0,0 +1,512 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/he-ru.h"
+#include "ns3/he-ru-tone-plan.h"
+#include "ns3/ru-allocator.h"
+#include "ns3/ru-packing-solver.h"
+#include <algorithm>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("RuAllocationTest");
+
+/**
+ * \param bandwidth the channel bandwidth in MHz (20, 40, 80 or 160)
+ * \param ruType the RU type
+ * \return the number of legal indices of the given RU type in an 80 MHz
+ *         segment (or in the whole channel if narrower), according to HeRu
+ */
+static std::size_t
+GetNLegalRus (uint16_t bandwidth, HeRu::RuType ruType)
+{
+  if (ruType == HeRu::RU_2x996_TONE)
+    {
+      return (bandwidth == 160 ? 1 : 0);
+    }
+  return HeRu::GetNRus (std::min<uint16_t> (bandwidth, 80), ruType);
+}
+
+/**
+ * Find by backtracking a placement of the given RUs that do not overlap.
+ *
+ * \param bandwidth the channel bandwidth in MHz (20, 40 or 80)
+ * \param ruTypes the types of the RUs to place, sorted in decreasing order
+ * \param placed the RUs placed so far
+ * \return true if the RUs following the placed ones can be placed
+ */
+static bool
+CanPlace (uint16_t bandwidth, const std::vector<HeRu::RuType>& ruTypes, std::vector<HeRu::RuSpec>& placed)
+{
+  std::size_t k = placed.size ();
+  if (k == ruTypes.size ())
+    {
+      return true;
+    }
+  // RUs of the same type are placed in increasing order of index
+  std::size_t first = (k > 0 && ruTypes[k - 1] == ruTypes[k] ? placed.back ().index + 1 : 1);
+  for (std::size_t index = first; index <= GetNLegalRus (bandwidth, ruTypes[k]); index++)
+    {
+      HeRu::RuSpec ru = {true, ruTypes[k], index};
+      if (!HeRu::DoesOverlap (bandwidth, ru, placed))
+        {
+          placed.push_back (ru);
+          if (CanPlace (bandwidth, ruTypes, placed))
+            {
+              placed.pop_back ();
+              return true;
+            }
+          placed.pop_back ();
+        }
+    }
+  return false;
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the value of the solution found by the RU packing solver
+ * is the maximum over all the assignments of RU types to the candidates whose
+ * RUs can be placed in the channel without overlapping, which are found by
+ * enumeration on small random value tables at 20, 40 and 80 MHz.
+ */
+class RuPackingSolverOptimalityTest : public TestCase
+{
+public:
+  RuPackingSolverOptimalityTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Compute by enumeration the maximum value of the assignments of RU types
+   * to the candidates starting from the given one.
+   *
+   * \param bandwidth the channel bandwidth in MHz
+   * \param values the value of each RU type for each candidate
+   * \param nCandidates the number of candidates
+   * \param i the first candidate to assign
+   * \param ruTypes the types of the RUs assigned to the previous candidates
+   * \return one plus the maximum value, or zero if no assignment of the
+   *         following candidates allows to place the RUs
+   */
+  static uint64_t Enumerate (uint16_t bandwidth, const std::vector<uint64_t>& values,
+                             std::size_t nCandidates, std::size_t i, std::vector<HeRu::RuType>& ruTypes);
+};
+
+RuPackingSolverOptimalityTest::RuPackingSolverOptimalityTest ()
+  : TestCase ("Check the RU packing solver against the enumeration of all the assignments")
+{
+}
+
+uint64_t
+RuPackingSolverOptimalityTest::Enumerate (uint16_t bandwidth, const std::vector<uint64_t>& values,
+                                          std::size_t nCandidates, std::size_t i,
+                                          std::vector<HeRu::RuType>& ruTypes)
+{
+  if (i == nCandidates)
+    {
+      std::vector<HeRu::RuType> sorted (ruTypes);
+      std::sort (sorted.begin (), sorted.end (), std::greater<HeRu::RuType> ());
+      std::vector<HeRu::RuSpec> placed;
+      return (CanPlace (bandwidth, sorted, placed) ? 1 : 0);
+    }
+
+  // the candidate is not assigned an RU
+  uint64_t best = Enumerate (bandwidth, values, nCandidates, i + 1, ruTypes);
+  for (std::size_t t = 0; t < HeRuTonePlan::N_RU_TYPES; t++)
+    {
+      if (GetNLegalRus (bandwidth, static_cast<HeRu::RuType> (t)) == 0)
+        {
+          continue;
+        }
+      ruTypes.push_back (static_cast<HeRu::RuType> (t));
+      uint64_t value = Enumerate (bandwidth, values, nCandidates, i + 1, ruTypes);
+      if (value > 0)
+        {
+          best = std::max (best, value + values[i * HeRuTonePlan::N_RU_TYPES + t]);
+        }
+      ruTypes.pop_back ();
+    }
+  return best;
+}
+
+void
+RuPackingSolverOptimalityTest::DoRun (void)
+{
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (1);
+  RuPackingSolver solver;
+  solver.SetBudget (100000000);
+
+  for (uint16_t bandwidth : {20, 40, 80})
+    {
+      std::size_t nCandidates = (bandwidth == 80 ? 4 : 5);
+      for (uint8_t run = 0; run < 10; run++)
+        {
+          std::vector<uint64_t> values (nCandidates * HeRuTonePlan::N_RU_TYPES);
+          for (auto& value : values)
+            {
+              value = rng->GetInteger (0, 1000);
+            }
+
+          NS_TEST_ASSERT_MSG_EQ (solver.Solve (bandwidth, values, nCandidates), nCandidates,
+                                 "The solver did not consider all the candidates");
+          std::vector<HeRu::RuType> ruTypes;
+          // the empty assignment is always feasible, hence Enumerate returns
+          // one plus the maximum value
+          uint64_t expected = Enumerate (bandwidth, values, nCandidates, 0, ruTypes) - 1;
+          NS_TEST_EXPECT_MSG_EQ (solver.GetValue (), expected, "Wrong value at " << bandwidth
+                                 << " MHz in run " << +run);
+
+          // the solution achieves its value and its RUs can be placed
+          uint64_t value = 0;
+          for (std::size_t i = 0; i < nCandidates; i++)
+            {
+              if (solver.IsAssigned (i))
+                {
+                  ruTypes.push_back (solver.GetRuType (i));
+                  value += values[i * HeRuTonePlan::N_RU_TYPES + solver.GetRuType (i)];
+                }
+            }
+          NS_TEST_EXPECT_MSG_EQ (value, solver.GetValue (), "The solution does not achieve its value");
+          std::sort (ruTypes.begin (), ruTypes.end (), std::greater<HeRu::RuType> ());
+          std::vector<HeRu::RuSpec> placed;
+          NS_TEST_EXPECT_MSG_EQ (CanPlace (bandwidth, ruTypes, placed), true,
+                                 "The RUs of the solution cannot be placed at " << bandwidth << " MHz");
+        }
+    }
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the RUs of the solutions found by the RU packing solver
+ * on random value tables at 20, 40, 80 and 160 MHz are all placed by the
+ * RuAllocator, in decreasing order of size, without overlapping.
+ */
+class RuPackingSolverPlacementTest : public TestCase
+{
+public:
+  RuPackingSolverPlacementTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+RuPackingSolverPlacementTest::RuPackingSolverPlacementTest ()
+  : TestCase ("Check that the solutions of the RU packing solver are placed by the RU allocator")
+{
+}
+
+void
+RuPackingSolverPlacementTest::DoRun (void)
+{
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (2);
+  RuPackingSolver solver;
+  solver.SetBudget (100000000);
+  RuAllocator allocator;
+
+  for (uint16_t bandwidth : {20, 40, 80, 160})
+    {
+      std::size_t maxCandidates = HeRuTonePlan::GetNRus (bandwidth, HeRu::RU_26_TONE) + 1;
+      for (uint8_t run = 0; run < 20; run++)
+        {
+          // values increasing with the RU size, with a random number of
+          // candidates and a random spread, so that solutions range from a
+          // single large RU to many small RUs
+          std::size_t nCandidates = rng->GetInteger (1, maxCandidates);
+          uint32_t spread = rng->GetInteger (0, 100);
+          std::vector<uint64_t> values (nCandidates * HeRuTonePlan::N_RU_TYPES);
+          for (std::size_t i = 0; i < nCandidates; i++)
+            {
+              uint64_t value = 0;
+              for (std::size_t t = 0; t < HeRuTonePlan::N_RU_TYPES; t++)
+                {
+                  value += rng->GetInteger (0, spread) * HeRuTonePlan::GetNSlots (static_cast<HeRu::RuType> (t));
+                  values[i * HeRuTonePlan::N_RU_TYPES + t] = value;
+                }
+            }
+
+          NS_TEST_ASSERT_MSG_EQ (solver.Solve (bandwidth, values, nCandidates), nCandidates,
+                                 "The solver did not consider all the candidates");
+          allocator.Reset (bandwidth);
+          std::vector<HeRu::RuSpec> allocated;
+          for (std::size_t t = HeRuTonePlan::N_RU_TYPES; t-- > 0; )
+            {
+              for (std::size_t i = 0; i < nCandidates; i++)
+                {
+                  if (!solver.IsAssigned (i) || static_cast<std::size_t> (solver.GetRuType (i)) != t)
+                    {
+                      continue;
+                    }
+                  HeRu::RuSpec ru;
+                  NS_TEST_ASSERT_MSG_EQ (allocator.Allocate (solver.GetRuType (i), ru), true,
+                                         "Failed to place an RU of type " << t << " at " << bandwidth
+                                         << " MHz in run " << +run);
+                  NS_TEST_EXPECT_MSG_EQ (HeRu::DoesOverlap (bandwidth, ru, allocated), false,
+                                         "RU " << ru << " overlaps with the RUs already placed");
+                  allocated.push_back (ru);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * \param bandwidth the channel bandwidth in MHz (20, 40, 80 or 160)
+ * \param ru the RU
+ * \param allocated the RUs already allocated
+ * \return whether the given RU overlaps with any of the allocated RUs
+ */
+static bool
+Overlaps (uint16_t bandwidth, const HeRu::RuSpec& ru, const std::vector<HeRu::RuSpec>& allocated)
+{
+  // a 2x996-tone RU overlaps with any other RU of a 160 MHz channel
+  if (ru.ruType == HeRu::RU_2x996_TONE)
+    {
+      return !allocated.empty ();
+    }
+  for (const auto& other : allocated)
+    {
+      if (other.ruType == HeRu::RU_2x996_TONE)
+        {
+          return true;
+        }
+    }
+  return HeRu::DoesOverlap (bandwidth, ru, allocated);
+}
+
+/**
+ * \param bandwidth the channel bandwidth in MHz (20, 40, 80 or 160)
+ * \param ruType the RU type
+ * \param allocated the RUs already allocated
+ * \return whether a legal RU of the given type does not overlap with any of
+ *         the allocated RUs, found by enumeration
+ */
+static bool
+ExistsFreeRu (uint16_t bandwidth, HeRu::RuType ruType, const std::vector<HeRu::RuSpec>& allocated)
+{
+  std::size_t nSegments = (bandwidth == 160 && ruType != HeRu::RU_2x996_TONE ? 2 : 1);
+  for (std::size_t segment = 0; segment < nSegments; segment++)
+    {
+      for (std::size_t index = 1; index <= GetNLegalRus (bandwidth, ruType); index++)
+        {
+          if (!Overlaps (bandwidth, {segment == 0, ruType, index}, allocated))
+            {
+              return true;
+            }
+        }
+    }
+  return false;
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the RUs allocated by the RuAllocator at 20, 40, 80 and
+ * 160 MHz have legal indices and never overlap, and that filling the channel
+ * with 26-tone RUs allocates all of them, including the center 26-tone RUs
+ * and the RUs of the secondary 80 MHz segment at 160 MHz.
+ */
+class RuAllocatorPlacementTest : public TestCase
+{
+public:
+  RuAllocatorPlacementTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Check that the given RU is legal and does not overlap with the RUs
+   * already allocated, then add it to the allocated RUs.
+   *
+   * \param bandwidth the channel bandwidth in MHz
+   * \param ru the RU
+   * \param allocated the RUs already allocated
+   */
+  void CheckRu (uint16_t bandwidth, const HeRu::RuSpec& ru, std::vector<HeRu::RuSpec>& allocated);
+};
+
+RuAllocatorPlacementTest::RuAllocatorPlacementTest ()
+  : TestCase ("Check that the RUs placed by the RU allocator are legal and do not overlap")
+{
+}
+
+void
+RuAllocatorPlacementTest::CheckRu (uint16_t bandwidth, const HeRu::RuSpec& ru, std::vector<HeRu::RuSpec>& allocated)
+{
+  NS_TEST_EXPECT_MSG_EQ ((ru.index >= 1 && ru.index <= GetNLegalRus (bandwidth, ru.ruType)), true,
+                         "Illegal RU " << ru << " at " << bandwidth << " MHz");
+  NS_TEST_EXPECT_MSG_EQ ((ru.primary80MHz || (bandwidth == 160 && ru.ruType != HeRu::RU_2x996_TONE)), true,
+                         "RU " << ru << " is not in the channel at " << bandwidth << " MHz");
+  NS_TEST_EXPECT_MSG_EQ (Overlaps (bandwidth, ru, allocated), false,
+                         "RU " << ru << " overlaps with the RUs already allocated at " << bandwidth << " MHz");
+  allocated.push_back (ru);
+}
+
+void
+RuAllocatorPlacementTest::DoRun (void)
+{
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (3);
+  RuAllocator allocator;
+  HeRu::RuSpec ru;
+
+  for (uint16_t bandwidth : {20, 40, 80, 160})
+    {
+      // all the 26-tone RUs are allocated
+      std::vector<HeRu::RuSpec> allocated;
+      allocator.Reset (bandwidth);
+      while (allocator.Allocate (HeRu::RU_26_TONE, ru))
+        {
+          CheckRu (bandwidth, ru, allocated);
+        }
+      std::size_t nSegments = (bandwidth == 160 ? 2 : 1);
+      NS_TEST_EXPECT_MSG_EQ (allocated.size (), nSegments * GetNLegalRus (bandwidth, HeRu::RU_26_TONE),
+                             "Not all the 26-tone RUs were allocated at " << bandwidth << " MHz");
+      std::size_t nCenters = 0;
+      std::size_t nSecondary = 0;
+      for (const auto& allocatedRu : allocated)
+        {
+          // the center 26-tone RUs of the 20 MHz blocks and of the 80 MHz segment
+          std::size_t index = allocatedRu.index;
+          nCenters += (index == 5 || index == 14 || index == 19 || index == 24 || index == 33 ? 1 : 0);
+          nSecondary += (allocatedRu.primary80MHz ? 0 : 1);
+        }
+      NS_TEST_EXPECT_MSG_EQ (nCenters, (bandwidth == 20 ? 1 : bandwidth == 40 ? 2 : 5 * nSegments),
+                             "Not all the center 26-tone RUs were allocated at " << bandwidth << " MHz");
+      NS_TEST_EXPECT_MSG_EQ (nSecondary, (bandwidth == 160 ? GetNLegalRus (80, HeRu::RU_26_TONE) : 0),
+                             "Unexpected number of RUs in the secondary 80 MHz at " << bandwidth << " MHz");
+
+      // random sequences of RU types
+      std::size_t maxType = (bandwidth == 20 ? HeRu::RU_242_TONE : bandwidth == 40 ? HeRu::RU_484_TONE
+                             : bandwidth == 80 ? HeRu::RU_996_TONE : HeRu::RU_2x996_TONE);
+      for (uint8_t run = 0; run < 50; run++)
+        {
+          allocated.clear ();
+          allocator.Reset (bandwidth);
+          for (uint8_t i = 0; i < 40; i++)
+            {
+              // smaller RUs are more likely, so that the channel is split finely
+              HeRu::RuType ruType = static_cast<HeRu::RuType> (std::min (rng->GetInteger (0, maxType),
+                                                                         rng->GetInteger (0, maxType)));
+              if (allocator.Allocate (ruType, ru))
+                {
+                  NS_TEST_EXPECT_MSG_EQ (ru.ruType, ruType, "Allocated an RU of a different type");
+                  CheckRu (bandwidth, ru, allocated);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Test that the RuAllocator fails to allocate an RU of a given type
+ * exactly when every legal RU of that type overlaps with the RUs already
+ * allocated, at 20, 40, 80 and 160 MHz.
+ */
+class RuAllocatorFullChannelTest : public TestCase
+{
+public:
+  RuAllocatorFullChannelTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+RuAllocatorFullChannelTest::RuAllocatorFullChannelTest ()
+  : TestCase ("Check that the RU allocator fails exactly when no RU of the requested type is free")
+{
+}
+
+void
+RuAllocatorFullChannelTest::DoRun (void)
+{
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (4);
+  RuAllocator allocator;
+  HeRu::RuSpec ru;
+
+  for (uint16_t bandwidth : {20, 40, 80, 160})
+    {
+      std::size_t maxType = (bandwidth == 20 ? HeRu::RU_242_TONE : bandwidth == 40 ? HeRu::RU_484_TONE
+                             : bandwidth == 80 ? HeRu::RU_996_TONE : HeRu::RU_2x996_TONE);
+      for (uint8_t run = 0; run < 20; run++)
+        {
+          std::vector<HeRu::RuSpec> allocated;
+          allocator.Reset (bandwidth);
+          bool full = false;
+          while (!full)
+            {
+              HeRu::RuType ruType = static_cast<HeRu::RuType> (rng->GetInteger (0, maxType));
+              bool expected = ExistsFreeRu (bandwidth, ruType, allocated);
+              NS_TEST_EXPECT_MSG_EQ (allocator.CanAllocate (ruType), expected,
+                                     "CanAllocate disagrees with the enumeration for type " << ruType
+                                     << " at " << bandwidth << " MHz");
+              NS_TEST_ASSERT_MSG_EQ (allocator.Allocate (ruType, ru), expected,
+                                     "Allocate disagrees with the enumeration for type " << ruType
+                                     << " at " << bandwidth << " MHz");
+              if (expected)
+                {
+                  allocated.push_back (ru);
+                }
+              // the channel is full when no 26-tone RU is free
+              full = !ExistsFreeRu (bandwidth, HeRu::RU_26_TONE, allocated);
+            }
+          NS_TEST_EXPECT_MSG_EQ (allocator.GetNFreeSlots (), 0, "The channel is full but free slots are left");
+          for (std::size_t type = 0; type <= maxType; type++)
+            {
+              NS_TEST_EXPECT_MSG_EQ (allocator.Allocate (static_cast<HeRu::RuType> (type), ru), false,
+                                     "Allocated an RU of type " << type << " in a full channel");
+            }
+        }
+    }
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief RU allocation Test Suite
+ */
+class RuAllocationTestSuite : public TestSuite
+{
+public:
+  RuAllocationTestSuite ();
+};
+
+RuAllocationTestSuite::RuAllocationTestSuite ()
+  : TestSuite ("wifi-ru-allocation", UNIT)
+{
+  AddTestCase (new RuPackingSolverOptimalityTest, TestCase::QUICK);
+  AddTestCase (new RuPackingSolverPlacementTest, TestCase::QUICK);
+  AddTestCase (new RuAllocatorPlacementTest, TestCase::QUICK);
+  AddTestCase (new RuAllocatorFullChannelTest, TestCase::QUICK);
+}
+
+static RuAllocationTestSuite g_ruAllocationTestSuite; ///< the test suite
@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "tx-duration-cache.h"
+#include "wifi-phy.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TxDurationCache");
+
+/// Bit set in every valid key (bit 40, just above the RU type field), so that empty entries never match
+static const uint64_t TX_DURATION_CACHE_VALID_KEY = uint64_t (1) << 40;
+
+TxDurationCache::TxDurationCache (std::size_t nEntries)
+  : m_channelWidth (0),
+    m_guardInterval (0),
+    m_frequency (0),
+    m_nHits (0),
+    m_nMisses (0)
+{
+  std::size_t size = 1;
+  while (size < nEntries)
+    {
+      size <<= 1;
+    }
+  m_entries.resize (size, {0, Seconds (0)});
+}
+
+void
+TxDurationCache::SetPhyParameters (uint16_t channelWidth, uint16_t guardInterval, uint16_t frequency)
+{
+  if (channelWidth != m_channelWidth || guardInterval != m_guardInterval || frequency != m_frequency)
+    {
+      NS_LOG_DEBUG ("PHY parameters changed, flush the cache");
+      Clear ();
+      m_channelWidth = channelWidth;
+      m_guardInterval = guardInterval;
+      m_frequency = frequency;
+    }
+}
+
+Time
+TxDurationCache::GetTxDuration (uint32_t size, const WifiTxVector& txVector, uint16_t staId)
+{
+  NS_ASSERT (txVector.GetHeMuUserInfoMap ().size () == 1);
+  NS_ASSERT (txVector.GetChannelWidth () == m_channelWidth && txVector.GetGuardInterval () == m_guardInterval);
+
+  const HeMuUserInfo& userInfo = txVector.GetHeMuUserInfo (staId);
+  uint64_t key = TX_DURATION_CACHE_VALID_KEY
+                 | (uint64_t (userInfo.ru.ruType) << 36)
+                 | (uint64_t (userInfo.nss & 0x0f) << 32)
+                 | (uint64_t (userInfo.mcs.GetMcsValue ()) << 24)
+                 | (size & 0x00ffffff);
+  NS_ASSERT (size <= 0x00ffffff);
+
+  // multiplicative hashing of the key
+  std::size_t index = (key * 0x9E3779B97F4A7C15ull) >> 32;
+  Entry& entry = m_entries[index & (m_entries.size () - 1)];
+
+  if (entry.key == key)
+    {
+      m_nHits++;
+      return entry.duration;
+    }
+
+  m_nMisses++;
+  entry.key = key;
+  entry.duration = WifiPhy::CalculateTxDuration (size, txVector, m_frequency, staId);
+  return entry.duration;
+}
+
+void
+TxDurationCache::Clear (void)
+{
+  for (auto& entry : m_entries)
+    {
+      entry.key = 0;
+    }
+}
+
+uint64_t
+TxDurationCache::GetNHits (void) const
+{
+  return m_nHits;
+}
+
+uint64_t
+TxDurationCache::GetNMisses (void) const
+{
+  return m_nMisses;
+}
+
+} //namespace ns3
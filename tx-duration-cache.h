@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TX_DURATION_CACHE_H
+#define TX_DURATION_CACHE_H
+
+#include "ns3/nstime.h"
+#include "wifi-tx-vector.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * TxDurationCache is a bounded, direct-mapped cache of the TX duration of HE
+ * MU PPDUs addressed to a single station. Entries are keyed on the RU type,
+ * the MCS, the number of spatial streams and the PSDU size, while the channel
+ * width, the guard interval and the operating frequency are shared by all the
+ * entries: the cache is flushed when any of them changes. When two keys map
+ * to the same entry, the most recent one replaces the other.
+ */
+class TxDurationCache
+{
+public:
+  /**
+   * Create a cache with the given number of entries.
+   *
+   * \param nEntries the number of entries (rounded up to a power of two)
+   */
+  TxDurationCache (std::size_t nEntries = 256);
+
+  /**
+   * Set the PHY parameters shared by all the entries. The cache is flushed if
+   * any of them differs from the current value.
+   *
+   * \param channelWidth the channel width in MHz
+   * \param guardInterval the guard interval in nanoseconds
+   * \param frequency the operating frequency in MHz
+   */
+  void SetPhyParameters (uint16_t channelWidth, uint16_t guardInterval, uint16_t frequency);
+  /**
+   * Get the TX duration of a PSDU of the given size transmitted to the given
+   * station in an HE MU PPDU using the given TX vector. The TX vector must
+   * include a single station and match the PHY parameters set through
+   * SetPhyParameters. The duration is computed and stored on a cache miss.
+   *
+   * \param size the PSDU size in bytes
+   * \param txVector the TX vector
+   * \param staId the STA-ID of the receiver station
+   * \return the TX duration of the PPDU
+   */
+  Time GetTxDuration (uint32_t size, const WifiTxVector& txVector, uint16_t staId);
+  /**
+   * Remove all the entries from the cache.
+   */
+  void Clear (void);
+
+  /**
+   * \return the number of lookups that found the TX duration in the cache
+   */
+  uint64_t GetNHits (void) const;
+  /**
+   * \return the number of lookups that required to compute the TX duration
+   */
+  uint64_t GetNMisses (void) const;
+
+private:
+  /// A cache entry
+  struct Entry
+  {
+    uint64_t key;   //!< the key of the entry (0 if the entry is empty)
+    Time duration;  //!< the TX duration
+  };
+
+  std::vector<Entry> m_entries;  //!< the cache entries
+  uint16_t m_channelWidth;       //!< the channel width in MHz
+  uint16_t m_guardInterval;      //!< the guard interval in nanoseconds
+  uint16_t m_frequency;          //!< the operating frequency in MHz
+  uint64_t m_nHits;              //!< number of cache hits
+  uint64_t m_nMisses;            //!< number of cache misses
+};
+
+} //namespace ns3
+
+#endif /* TX_DURATION_CACHE_H */